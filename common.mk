@@ -12,6 +12,7 @@ SRC +=	$(COMMON_DIR)/host.c \
 	$(COMMON_DIR)/debug.c \
 	$(COMMON_DIR)/bootloader.c \
 	$(COMMON_DIR)/suspend.c \
+	$(COMMON_DIR)/defer.c \
 	$(COMMON_DIR)/xprintf.S \
 	$(COMMON_DIR)/util.c
 
@@ -23,6 +24,10 @@ ifdef BOOTMAGIC_ENABLE
     OPT_DEFS += -DBOOTMAGIC_ENABLE
 endif
 
+ifdef DEBOUNCE_ENABLE
+    SRC += $(COMMON_DIR)/debounce.c
+endif
+
 ifdef MOUSEKEY_ENABLE
     SRC += $(COMMON_DIR)/mousekey.c
     OPT_DEFS += -DMOUSEKEY_ENABLE
@@ -64,6 +69,31 @@ ifdef BACKLIGHT_ENABLE
     OPT_DEFS += -DBACKLIGHT_ENABLE
 endif
 
+ifdef MATRIX_EVENT_QUEUE_ENABLE
+    SRC += $(COMMON_DIR)/matrix_event.c
+    OPT_DEFS += -DMATRIX_EVENT_QUEUE
+endif
+
+ifdef MATRIX_IDLE_ENABLE
+    SRC += $(COMMON_DIR)/matrix_idle.c
+    OPT_DEFS += -DMATRIX_IDLE_ENABLE
+endif
+
+ifdef LATENCY_TRACE_ENABLE
+    SRC += $(COMMON_DIR)/latency.c
+    OPT_DEFS += -DLATENCY_TRACE
+endif
+
+ifdef STARTUP_TRACE_ENABLE
+    SRC += $(COMMON_DIR)/startup_trace.c
+    OPT_DEFS += -DSTARTUP_TRACE
+endif
+
+ifdef DEBUG_TRACE_ENABLE
+    SRC += $(COMMON_DIR)/trace.c
+    OPT_DEFS += -DDEBUG_TRACE
+endif
+
 ifdef KEYMAP_SECTION_ENABLE
     OPT_DEFS += -DKEYMAP_SECTION_ENABLE
     EXTRALDFLAGS = -Wl,-L$(TOP_DIR),-Tldscript_keymap_avr5.x
@@ -27,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "action_util.h"
 #include "action.h"
 #include "uart.h"
+#include "latency.h"
+#include "trace.h"
 #ifdef DEBUG_ACTION
 #include "debug.h"
 #else
@@ -37,8 +39,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 void action_exec(keyevent_t event)
 {
     if (!IS_NOEVENT(event)) {
+        LATENCY_MARK(LATENCY_ACTION_EXEC);
+        TRACE(TRACE_ACTION_EXEC, event.key.row<<8 | event.key.col, event.pressed);
         dprint("\n---- action_exec: start -----\n");
         dprint("EVENT: "); debug_event(event); dprintln();
+#ifdef MACRO_CANCEL_ON_PRESS
+        // key press stops macro being played
+        if (event.pressed) action_macro_cancel();
+#endif
     }
 
     keyrecord_t record = { .event = event };
@@ -61,8 +69,10 @@ void process_action(keyrecord_t *record)
 #endif
 
     if (IS_NOEVENT(event)) { return; }
+    LATENCY_MARK(LATENCY_PROCESS_ACTION);
 
     action_t action = layer_switch_get_action(event.key);
+    TRACE(TRACE_PROCESS_ACTION, action.code, layer_state);
     dprint("ACTION: "); debug_action(action);
 #ifndef NO_ACTION_LAYER
     dprint(" layer_state: "); layer_debug();
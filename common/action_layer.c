@@ -11,6 +11,27 @@
 #endif
 
 
+#if !defined(NO_ACTION_LAYER) && defined(ACTION_LAYER_CACHE)
+/*
+ * Layer cache
+ *      Remembers layer which action of key comes from(layer + 1, 0: not resolved)
+ *      so that layers are not searched on every event. Cleared when layer state changes.
+ */
+static uint8_t layer_cache[MATRIX_ROWS][MATRIX_COLS];
+
+static void layer_cache_clear(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+            layer_cache[r][c] = 0;
+        }
+    }
+}
+#else
+#define layer_cache_clear()
+#endif
+
+
 /* 
  * Default Layer State
  */
@@ -21,6 +42,7 @@ static void default_layer_state_set(uint32_t state)
     debug("default_layer_state: ");
     default_layer_debug(); debug(" to ");
     default_layer_state = state;
+    layer_cache_clear();
     default_layer_debug(); debug("\n");
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
@@ -62,6 +84,7 @@ static void layer_state_set(uint32_t state)
     dprint("layer_state: ");
     layer_debug(); dprint(" to ");
     layer_state = state;
+    layer_cache_clear();
     layer_debug(); dprintln();
     clear_keyboard_but_mods(); // To avoid stuck keys
 }
@@ -118,18 +141,30 @@ action_t layer_switch_get_action(key_t key)
     action.code = ACTION_TRANSPARENT;
 
 #ifndef NO_ACTION_LAYER
+#ifdef ACTION_LAYER_CACHE
+    uint8_t *cache = &layer_cache[key.row][key.col];
+    if (*cache) {
+        return action_for_key(*cache - 1, key);
+    }
+#endif
     uint32_t layers = layer_state | default_layer_state;
     /* check top layer first */
     for (int8_t i = 31; i >= 0; i--) {
         if (layers & (1UL<<i)) {
             action = action_for_key(i, key);
             if (action.code != ACTION_TRANSPARENT) {
+#ifdef ACTION_LAYER_CACHE
+                *cache = i + 1;
+#endif
                 return action;
             }
         }
     }
     /* fall back to layer 0 */
     action = action_for_key(0, key);
+#ifdef ACTION_LAYER_CACHE
+    *cache = 1;
+#endif
     return action;
 #else
     action = action_for_key(biton32(default_layer_state), key);
@@ -14,10 +14,11 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include <util/delay.h>
 #include "action.h"
 #include "action_util.h"
 #include "action_macro.h"
+#include "host.h"
+#include "defer.h"
 
 #ifdef DEBUG_ACTION
 #include "debug.h"
@@ -28,56 +29,141 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #ifndef NO_ACTION_MACRO
 
-#define MACRO_READ()  (macro = pgm_read_byte(macro_p++))
+/*
+ * Macro player
+ *
+ * Each running macro has a cursor into PROGMEM and executes one step per
+ * call of macro_step(). Next step is scheduled with defer_exec() after
+ * WAIT and INTERVAL time, so that keyboard_task() keeps scanning matrix
+ * while macro is played. A step is held while host driver has no room for
+ * its report, otherwise short INTERVAL overruns report queue of the driver.
+ */
+typedef struct {
+    const macro_t *macro_p;    /* NULL: not playing */
+    uint8_t interval;
+} macro_player_t;
+
+static macro_player_t players[MACRO_PLAYERS] = {};
+
+
+static void macro_step(uint8_t id);
+
 void action_macro_play(const macro_t *macro_p)
 {
+    if (!macro_p) return;
+    for (uint8_t id = 0; id < MACRO_PLAYERS; id++) {
+        if (players[id].macro_p) continue;
+        // first step runs in next keyboard_task()
+        if (!defer_exec(0, macro_step, id)) break;
+        players[id] = (macro_player_t){ .macro_p = macro_p, .interval = 0 };
+        return;
+    }
+    dprint("MACRO: busy\n");
+}
+
+#define MACRO_READ()  (macro = pgm_read_byte(p->macro_p++))
+static void macro_step(uint8_t id)
+{
+    macro_player_t *p = &players[id];
     macro_t macro = END;
-    uint8_t interval = 0;
+    uint8_t wait = 0;
 
-    if (!macro_p) return;
-    while (true) {
-        switch (MACRO_READ()) {
-            case KEY_DOWN:
-                MACRO_READ();
-                dprintf("KEY_DOWN(%02X)\n", macro);
-                if (IS_MOD(macro)) {
-                    add_weak_mods(MOD_BIT(macro));
-                } else {
-                    register_code(macro);
-                }
-                break;
-            case KEY_UP:
-                MACRO_READ();
-                dprintf("KEY_UP(%02X)\n", macro);
-                if (IS_MOD(macro)) {
-                    del_weak_mods(MOD_BIT(macro));
-                } else {
-                    unregister_code(macro);
-                }
-                break;
-            case WAIT:
-                MACRO_READ();
-                dprintf("WAIT(%u)\n", macro);
-                { uint8_t ms = macro; while (ms--) _delay_ms(1); }
-                break;
-            case INTERVAL:
-                interval = MACRO_READ();
-                dprintf("INTERVAL(%u)\n", interval);
-                break;
-            case 0x04 ... 0x73:
-                dprintf("DOWN(%02X)\n", macro);
+    if (host_send_busy()) {
+        // retry after next host poll
+        defer_exec(1, macro_step, id);
+        return;
+    }
+
+    switch (MACRO_READ()) {
+        case KEY_DOWN:
+            MACRO_READ();
+            dprintf("KEY_DOWN(%02X)\n", macro);
+            if (IS_MOD(macro)) {
+                add_weak_mods(MOD_BIT(macro));
+            } else {
                 register_code(macro);
-                break;
-            case 0x84 ... 0xF3:
-                dprintf("UP(%02X)\n", macro);
-                unregister_code(macro&0x7F);
-                break;
-            case END:
-            default:
-                return;
+            }
+            break;
+        case KEY_UP:
+            MACRO_READ();
+            dprintf("KEY_UP(%02X)\n", macro);
+            if (IS_MOD(macro)) {
+                del_weak_mods(MOD_BIT(macro));
+            } else {
+                unregister_code(macro);
+            }
+            break;
+        case WAIT:
+            MACRO_READ();
+            dprintf("WAIT(%u)\n", macro);
+            wait = macro;
+            break;
+        case INTERVAL:
+            p->interval = MACRO_READ();
+            dprintf("INTERVAL(%u)\n", p->interval);
+            break;
+        case 0x04 ... 0x73:
+            dprintf("DOWN(%02X)\n", macro);
+            register_code(macro);
+            break;
+        case 0x84 ... 0xF3:
+            dprintf("UP(%02X)\n", macro);
+            unregister_code(macro&0x7F);
+            break;
+        case END:
+        default:
+            p->macro_p = 0;
+            return;
+    }
+    // slot of this call was freed before the call and is always available
+    defer_exec(wait + p->interval, macro_step, id);
+}
+
+void action_macro_cancel(void)
+{
+    defer_cancel(macro_step);
+    for (uint8_t id = 0; id < MACRO_PLAYERS; id++) {
+        macro_player_t *p = &players[id];
+        macro_t macro = END;
+        if (!p->macro_p) continue;
+
+        // release keys the macro would release in the rest of it
+        dprint("MACRO: cancel\n");
+        while (true) {
+            switch (MACRO_READ()) {
+                case KEY_DOWN:
+                case WAIT:
+                case INTERVAL:
+                    MACRO_READ();
+                    continue;
+                case KEY_UP:
+                    MACRO_READ();
+                    if (IS_MOD(macro)) {
+                        del_weak_mods(MOD_BIT(macro));
+                    } else {
+                        unregister_code(macro);
+                    }
+                    continue;
+                case 0x04 ... 0x73:
+                    continue;
+                case 0x84 ... 0xF3:
+                    unregister_code(macro&0x7F);
+                    continue;
+                case END:
+                default:
+                    break;
+            }
+            break;
         }
-        // interval
-        { uint8_t ms = interval; while (ms--) _delay_ms(1); }
+        p->macro_p = 0;
+    }
+}
+
+bool action_macro_playing(void)
+{
+    for (uint8_t id = 0; id < MACRO_PLAYERS; id++) {
+        if (players[id].macro_p) return true;
     }
+    return false;
 }
 #endif
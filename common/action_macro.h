@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef ACTION_MACRO_H
 #define ACTION_MACRO_H
 #include <stdint.h>
+#include <stdbool.h>
 #include <avr/pgmspace.h>
 
 
@@ -27,10 +28,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 typedef uint8_t macro_t;
 
 
+/* number of macros played at the same time */
+#ifndef MACRO_PLAYERS
+#define MACRO_PLAYERS   2
+#endif
+
+
 #ifndef NO_ACTION_MACRO
+/* start playing macro in background, steps are executed from keyboard_task() */
 void action_macro_play(const macro_t *macro_p);
+/* stop all macros and release keys they would release */
+void action_macro_cancel(void);
+bool action_macro_playing(void);
 #else
 #define action_macro_play(macro)
+#define action_macro_cancel()
+#define action_macro_playing()  false
 #endif
 
 
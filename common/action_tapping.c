@@ -4,6 +4,7 @@
 #include "action_layer.h"
 #include "action_tapping.h"
 #include "keycode.h"
+#include "matrix.h"
 #include "timer.h"
 
 #ifdef DEBUG_ACTION
@@ -18,17 +19,29 @@
 #define IS_TAPPING_PRESSED()    (IS_TAPPING() && tapping_key.event.pressed)
 #define IS_TAPPING_RELEASED()   (IS_TAPPING() && !tapping_key.event.pressed)
 #define IS_TAPPING_KEY(k)       (IS_TAPPING() && KEYEQ(tapping_key.event.key, (k)))
-#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < TAPPING_TERM)
+#ifdef TAPPING_TERM_PER_KEY
+#define GET_TAPPING_TERM()      action_get_tapping_term(&tapping_key)
+#else
+#define GET_TAPPING_TERM()      TAPPING_TERM
+#endif
+#define WITHIN_TAPPING_TERM(e)  (TIMER_DIFF_16(e.time, tapping_key.event.time) < GET_TAPPING_TERM())
 
 
 static keyrecord_t tapping_key = {};
 static keyrecord_t waiting_buffer[WAITING_BUFFER_SIZE] = {};
 static uint8_t waiting_buffer_head = 0;
 static uint8_t waiting_buffer_tail = 0;
+/* index of waiting_buffer: bit of key is on while it has press/release event of the key */
+static matrix_row_t waiting_pressed[MATRIX_ROWS];
+static matrix_row_t waiting_released[MATRIX_ROWS];
+static uint8_t waiting_pressed_count = 0;
 
 static bool process_tapping(keyrecord_t *record);
 static bool waiting_buffer_enq(keyrecord_t record);
+static void waiting_buffer_deq(void);
 static void waiting_buffer_clear(void);
+static void waiting_buffer_process(void);
+static void waiting_buffer_settle(void);
 static bool waiting_buffer_typed(keyevent_t event);
 static bool waiting_buffer_has_anykey_pressed(void);
 static void waiting_buffer_scan_tap(void);
@@ -44,11 +57,15 @@ void action_tapping_process(keyrecord_t record)
         }
     } else {
         if (!waiting_buffer_enq(record)) {
-            // clear all in case of overflow.
-            debug("OVERFLOW: CLEAR ALL STATES\n");
-            clear_keyboard();
-            waiting_buffer_clear();
-            tapping_key = (keyrecord_t){};
+            // settle tapping key to make room in case of overflow.
+            debug("OVERFLOW: SETTLE TAPPING KEY\n");
+            waiting_buffer_settle();
+            if (!waiting_buffer_enq(record)) {
+                debug("OVERFLOW: CLEAR ALL STATES\n");
+                clear_keyboard();
+                waiting_buffer_clear();
+                tapping_key = (keyrecord_t){};
+            }
         }
     }
 
@@ -56,14 +73,7 @@ void action_tapping_process(keyrecord_t record)
     if (!IS_NOEVENT(record.event) && waiting_buffer_head != waiting_buffer_tail) {
         debug("---- action_exec: process waiting_buffer -----\n");
     }
-    for (; waiting_buffer_tail != waiting_buffer_head; waiting_buffer_tail = (waiting_buffer_tail + 1) % WAITING_BUFFER_SIZE) {
-        if (process_tapping(&waiting_buffer[waiting_buffer_tail])) {
-            debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
-            debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
-        } else {
-            break;
-        }
-    }
+    waiting_buffer_process();
     if (!IS_NOEVENT(record.event)) {
         debug("\n");
     }
@@ -96,7 +106,7 @@ bool process_tapping(keyrecord_t *keyp)
                     // enqueue
                     return false;
                 }
-#if TAPPING_TERM >= 500
+#if TAPPING_TERM >= 500 || defined(TAPPING_PERMISSIVE_HOLD)
                 /* Process a key typed within TAPPING_TERM
                  * This can register the key before settlement of tapping,
                  * useful for long TAPPING_TERM but may prevent fast typing.
@@ -138,6 +148,12 @@ bool process_tapping(keyrecord_t *keyp)
                     // set interrupted flag when other key preesed during tapping
                     if (event.pressed) {
                         tapping_key.tap.interrupted = true;
+#ifdef TAPPING_HOLD_ON_OTHER_KEY_PRESS
+                        debug("Tapping: End. No tap. Interfered by pressing key\n");
+                        process_action(&tapping_key);
+                        tapping_key = (keyrecord_t){};
+                        debug_tapping_key();
+#endif
                     }
                     // enqueue 
                     return false;
@@ -287,6 +303,15 @@ bool process_tapping(keyrecord_t *keyp)
 }
 
 
+#ifdef TAPPING_TERM_PER_KEY
+__attribute__ ((weak))
+uint16_t action_get_tapping_term(keyrecord_t *record)
+{
+    return TAPPING_TERM;
+}
+#endif
+
+
 /*
  * Waiting buffer
  */
@@ -303,33 +328,86 @@ bool waiting_buffer_enq(keyrecord_t record)
 
     waiting_buffer[waiting_buffer_head] = record;
     waiting_buffer_head = (waiting_buffer_head + 1) % WAITING_BUFFER_SIZE;
+    if (record.event.pressed) {
+        waiting_pressed[record.event.key.row] |= ((matrix_row_t)1<<record.event.key.col);
+        waiting_pressed_count++;
+    } else {
+        waiting_released[record.event.key.row] |= ((matrix_row_t)1<<record.event.key.col);
+    }
 
     debug("waiting_buffer_enq: "); debug_waiting_buffer();
     return true;
 }
 
+/* remove oldest event and its index unless other event of the key remains */
+void waiting_buffer_deq(void)
+{
+    keyevent_t event = waiting_buffer[waiting_buffer_tail].event;
+    waiting_buffer_tail = (waiting_buffer_tail + 1) % WAITING_BUFFER_SIZE;
+
+    matrix_row_t *index = event.pressed ? waiting_pressed : waiting_released;
+    if (event.pressed) waiting_pressed_count--;
+    index[event.key.row] &= ~((matrix_row_t)1<<event.key.col);
+    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
+        if (KEYEQ(event.key, waiting_buffer[i].event.key) && event.pressed == waiting_buffer[i].event.pressed) {
+            index[event.key.row] |= ((matrix_row_t)1<<event.key.col);
+            break;
+        }
+    }
+}
+
 void waiting_buffer_clear(void)
 {
     waiting_buffer_head = 0;
     waiting_buffer_tail = 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        waiting_pressed[i] = 0;
+        waiting_released[i] = 0;
+    }
+    waiting_pressed_count = 0;
 }
 
-bool waiting_buffer_typed(keyevent_t event)
+void waiting_buffer_process(void)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (KEYEQ(event.key, waiting_buffer[i].event.key) && event.pressed !=  waiting_buffer[i].event.pressed) {
-            return true;
+    while (waiting_buffer_tail != waiting_buffer_head) {
+        keyevent_t tapping = tapping_key.event;
+        if (!process_tapping(&waiting_buffer[waiting_buffer_tail])) {
+            // event settled tapping key: process it again in new state, otherwise it
+            // stays in buffer while next event is processed ahead of it.
+            if (!KEYEQ(tapping.key, tapping_key.event.key) ||
+                    tapping.pressed != tapping_key.event.pressed ||
+                    tapping.time != tapping_key.event.time) continue;
+            break;
         }
+        debug("processed: waiting_buffer["); debug_dec(waiting_buffer_tail); debug("] = ");
+        debug_record(waiting_buffer[waiting_buffer_tail]); debug("\n\n");
+        waiting_buffer_deq();
     }
-    return false;
 }
 
-bool waiting_buffer_has_anykey_pressed(void)
+/* Settle undecided tapping key as hold(not tap) and process events waiting for it.
+ * Events after that are processed as usual; tap key in them can start tapping again.
+ */
+void waiting_buffer_settle(void)
 {
-    for (uint8_t i = waiting_buffer_tail; i != waiting_buffer_head; i = (i + 1) % WAITING_BUFFER_SIZE) {
-        if (waiting_buffer[i].event.pressed) return true;
+    if (IS_TAPPING_PRESSED() && tapping_key.tap.count == 0) {
+        debug("Tapping: End. Not tap(0) by overflow.\n");
+        process_action(&tapping_key);
+        tapping_key = (keyrecord_t){};
+        debug_tapping_key();
     }
-    return false;
+    waiting_buffer_process();
+}
+
+bool waiting_buffer_typed(keyevent_t event)
+{
+    matrix_row_t *index = event.pressed ? waiting_released : waiting_pressed;
+    return index[event.key.row] & ((matrix_row_t)1<<event.key.col);
+}
+
+bool waiting_buffer_has_anykey_pressed(void)
+{
+    return waiting_pressed_count;
 }
 
 /* scan buffer for tapping */
@@ -24,16 +24,35 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define TAPPING_TERM    200
 #endif
 
+/* Resolution of tap key pressed with other keys, settled as hold(not tap) as soon as:
+ *      TAPPING_PERMISSIVE_HOLD         other key is pressed and released while holding tap key
+ *      TAPPING_HOLD_ON_OTHER_KEY_PRESS other key is pressed while holding tap key
+ * Otherwise it is settled when tap key is released or TAPPING_TERM passes.
+ * (TAPPING_TERM of 500 or longer implies TAPPING_PERMISSIVE_HOLD.)
+ *
+ * TAPPING_TERM_PER_KEY: period of tapping is given by action_get_tapping_term().
+ */
+
 /* tap count needed for toggling a feature */
 #ifndef TAPPING_TOGGLE
 #define TAPPING_TOGGLE  5
 #endif
 
+/* events held while tapping is not settled, power of 2 */
+#ifndef WAITING_BUFFER_SIZE
 #define WAITING_BUFFER_SIZE 8
+#endif
+#if (WAITING_BUFFER_SIZE & (WAITING_BUFFER_SIZE - 1)) || WAITING_BUFFER_SIZE > 128
+#   error "WAITING_BUFFER_SIZE must be power of 2 and 128 at most"
+#endif
 
 
 #ifndef NO_ACTION_TAPPING
 void action_tapping_process(keyrecord_t record);
+#ifdef TAPPING_TERM_PER_KEY
+/* period of tapping(ms) for the tap key, TAPPING_TERM by default */
+uint16_t action_get_tapping_term(keyrecord_t *record);
+#endif
 #endif
 
 #endif
@@ -14,6 +14,7 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <string.h>
 #include "host.h"
 #include "report.h"
 #include "debug.h"
@@ -30,6 +31,11 @@ static inline void del_key_bit(uint8_t code);
 static uint8_t real_mods = 0;
 static uint8_t weak_mods = 0;
 
+/* keys part of report changed since last send */
+static bool keys_dirty = true;
+static uint8_t last_mods = 0;
+static uint16_t suppressed_count = 0;
+
 #ifdef USB_6KRO_ENABLE
 #define RO_ADD(a, b) ((a + b) % REPORT_KEYS)
 #define RO_SUB(a, b) ((a - b + REPORT_KEYS) % REPORT_KEYS)
@@ -40,6 +46,28 @@ static int8_t cb_tail = 0;
 static int8_t cb_count = 0;
 #endif
 
+/* number of keys in report */
+static uint8_t key_count = 0;
+
+/* keycode to report slot index(slot + 1, 0 when not in report), packed in nibbles */
+#if REPORT_KEYS > 15
+#   error "REPORT_KEYS is too large for slot index"
+#endif
+static uint8_t key_slot[128];
+
+static inline uint8_t slot_get(uint8_t code)
+{
+    return (code & 1) ? key_slot[code>>1]>>4 : key_slot[code>>1] & 0x0F;
+}
+
+static inline void slot_set(uint8_t code, uint8_t slot)
+{
+    if (code & 1)
+        key_slot[code>>1] = (key_slot[code>>1] & 0x0F) | (slot<<4);
+    else
+        key_slot[code>>1] = (key_slot[code>>1] & 0xF0) | slot;
+}
+
 // TODO: pointer variable is not needed
 //report_keyboard_t keyboard_report = {};
 report_keyboard_t *keyboard_report = &(report_keyboard_t){};
@@ -69,9 +97,21 @@ void send_keyboard_report(void) {
         }
     }
 #endif
+    /* send only real changes */
+    if (!keys_dirty && keyboard_report->mods == last_mods) {
+        suppressed_count++;
+        return;
+    }
+    keys_dirty = false;
+    last_mods = keyboard_report->mods;
     host_keyboard_send(keyboard_report);
 }
 
+uint16_t get_suppressed_report_count(void)
+{
+    return suppressed_count;
+}
+
 /* key */
 void add_key(uint8_t key)
 {
@@ -97,10 +137,20 @@ void del_key(uint8_t key)
 
 void clear_keys(void)
 {
+    // keyboard_nkro may have changed since keys were added
+    memset(key_slot, 0, sizeof(key_slot));
+
     // not clear mods
     for (int8_t i = 1; i < REPORT_SIZE; i++) {
-        keyboard_report->raw[i] = 0;
+        if (keyboard_report->raw[i]) {
+            keyboard_report->raw[i] = 0;
+            keys_dirty = true;
+        }
     }
+    key_count = 0;
+#ifdef USB_6KRO_ENABLE
+    cb_head = cb_tail = cb_count = 0;
+#endif
 }
 
 
@@ -144,12 +194,7 @@ void clear_oneshot_mods(void)
  */
 uint8_t has_anykey(void)
 {
-    uint8_t cnt = 0;
-    for (uint8_t i = 1; i < REPORT_SIZE; i++) {
-        if (keyboard_report->raw[i])
-            cnt++;
-    }
-    return cnt;
+    return key_count;
 }
 
 uint8_t has_anymod(void)
@@ -159,6 +204,7 @@ uint8_t has_anymod(void)
 
 uint8_t get_first_key(void)
 {
+    if (!key_count) return 0;
 #ifdef NKRO_ENABLE
     if (keyboard_nkro) {
         uint8_t i = 0;
@@ -168,14 +214,8 @@ uint8_t get_first_key(void)
     }
 #endif
 #ifdef USB_6KRO_ENABLE
-    uint8_t i = cb_head;
-    do {
-        if (keyboard_report->keys[i] != 0) {
-            break;
-        }
-        i = RO_INC(i);
-    } while (i != cb_tail);
-    return keyboard_report->keys[i];
+    // head never points to empty slot while buffer has key
+    return keyboard_report->keys[cb_head];
 #else
     return keyboard_report->keys[0];
 #endif
@@ -186,102 +226,89 @@ uint8_t get_first_key(void)
 /* local functions */
 static inline void add_key_byte(uint8_t code)
 {
+    if (slot_get(code)) {
+        return;
+    }
 #ifdef USB_6KRO_ENABLE
-    int8_t i = cb_head;
-    int8_t empty = -1;
-    if (cb_count) {
-        do {
-            if (keyboard_report->keys[i] == code) {
-                return;
-            }
-            if (empty == -1 && keyboard_report->keys[i] == 0) {
-                empty = i;
-            }
-            i = RO_INC(i);
-        } while (i != cb_tail);
-        if (i == cb_tail) {
-            if (cb_tail == cb_head) {
-                // buffer is full
-                if (empty == -1) {
-                    // pop head when has no empty space
-                    cb_head = RO_INC(cb_head);
-                    cb_count--;
-                }
-                else {
-                    // left shift when has empty space
-                    uint8_t offset = 1;
-                    i = RO_INC(empty);
-                    do {
-                        if (keyboard_report->keys[i] != 0) {
-                            keyboard_report->keys[empty] = keyboard_report->keys[i];
-                            keyboard_report->keys[i] = 0;
-                            empty = RO_INC(empty);
-                        }
-                        else {
-                            offset++;
-                        }
-                        i = RO_INC(i);
-                    } while (i != cb_tail);
-                    cb_tail = RO_SUB(cb_tail, offset);
+    if (cb_count && cb_tail == cb_head) {
+        // buffer is full
+        if (cb_count == REPORT_KEYS) {
+            // pop head when has no empty space
+            slot_set(keyboard_report->keys[cb_head], 0);
+            cb_head = RO_INC(cb_head);
+            cb_count--;
+            key_count--;
+        }
+        else {
+            // left shift when has empty space
+            int8_t empty = cb_head;
+            int8_t i = cb_head;
+            do {
+                if (keyboard_report->keys[i] != 0) {
+                    keyboard_report->keys[empty] = keyboard_report->keys[i];
+                    slot_set(keyboard_report->keys[empty], empty + 1);
+                    if (i != empty) keyboard_report->keys[i] = 0;
+                    empty = RO_INC(empty);
                 }
-            }
+                i = RO_INC(i);
+            } while (i != cb_tail);
+            cb_tail = empty;
         }
     }
     // add to tail
     keyboard_report->keys[cb_tail] = code;
+    slot_set(code, cb_tail + 1);
     cb_tail = RO_INC(cb_tail);
     cb_count++;
 #else
-    int8_t i = 0;
-    int8_t empty = -1;
-    for (; i < REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            break;
-        }
-        if (empty == -1 && keyboard_report->keys[i] == 0) {
-            empty = i;
-        }
-    }
-    if (i == REPORT_KEYS) {
-        if (empty != -1) {
-            keyboard_report->keys[empty] = code;
-        }
+    // keys are packed from slot 0
+    if (key_count >= REPORT_KEYS) {
+        return;
     }
+    keyboard_report->keys[key_count] = code;
+    slot_set(code, key_count + 1);
 #endif
+    key_count++;
+    keys_dirty = true;
 }
 
 static inline void del_key_byte(uint8_t code)
 {
+    uint8_t slot = slot_get(code);
+    if (!slot) {
+        return;
+    }
+    uint8_t i = slot - 1;
+    slot_set(code, 0);
+    keys_dirty = true;
+    key_count--;
 #ifdef USB_6KRO_ENABLE
-    uint8_t i = cb_head;
-    if (cb_count) {
+    keyboard_report->keys[i] = 0;
+    cb_count--;
+    if (cb_count == 0) {
+        // reset head and tail
+        cb_tail = cb_head = 0;
+        return;
+    }
+    if (i == cb_head) {
+        // skip empty slots from head
         do {
-            if (keyboard_report->keys[i] == code) {
-                keyboard_report->keys[i] = 0;
-                cb_count--;
-                if (cb_count == 0) {
-                    // reset head and tail
-                    cb_tail = cb_head = 0;
-                }
-                if (i == RO_DEC(cb_tail)) {
-                    // left shift when next to tail
-                    do {
-                        cb_tail = RO_DEC(cb_tail);
-                        if (keyboard_report->keys[RO_DEC(cb_tail)] != 0) {
-                            break;
-                        }
-                    } while (cb_tail != cb_head);
-                }
-                break;
-            }
-            i = RO_INC(i);
-        } while (i != cb_tail);
+            cb_head = RO_INC(cb_head);
+        } while (keyboard_report->keys[cb_head] == 0);
+    }
+    else if (i == RO_DEC(cb_tail)) {
+        // left shift when next to tail
+        do {
+            cb_tail = RO_DEC(cb_tail);
+        } while (keyboard_report->keys[RO_DEC(cb_tail)] == 0);
     }
 #else
-    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
-        if (keyboard_report->keys[i] == code) {
-            keyboard_report->keys[i] = 0;
-        }
+    // fill the hole with last key to keep keys packed
+    uint8_t last = keyboard_report->keys[key_count];
+    keyboard_report->keys[key_count] = 0;
+    if (i != key_count) {
+        keyboard_report->keys[i] = last;
+        slot_set(last, i + 1);
     }
 #endif
 }
@@ -290,7 +317,11 @@ static inline void del_key_byte(uint8_t code)
 static inline void add_key_bit(uint8_t code)
 {
     if ((code>>3) < REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
+        if (!(keyboard_report->nkro.bits[code>>3] & 1<<(code&7))) {
+            keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
+            key_count++;
+            keys_dirty = true;
+        }
     } else {
         dprintf("add_key_bit: can't add: %02X\n", code);
     }
@@ -299,7 +330,11 @@ static inline void add_key_bit(uint8_t code)
 static inline void del_key_bit(uint8_t code)
 {
     if ((code>>3) < REPORT_BITS) {
-        keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
+        if (keyboard_report->nkro.bits[code>>3] & 1<<(code&7)) {
+            keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
+            key_count--;
+            keys_dirty = true;
+        }
     } else {
         dprintf("del_key_bit: can't del: %02X\n", code);
     }
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 extern report_keyboard_t *keyboard_report;
 
 void send_keyboard_report(void);
+uint16_t get_suppressed_report_count(void);
 
 /* key */
 void add_key(uint8_t key);
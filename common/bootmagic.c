@@ -9,8 +9,41 @@
 #include "action_layer.h"
 #include "eeconfig.h"
 #include "bootmagic.h"
+#include "debounce.h"
 
 
+/* matrix drivers without common/debounce.c debounce by themselves in matrix_scan() */
+__attribute__ ((weak))
+bool debounce_active(void)
+{
+    return false;
+}
+
+/* scan until matrix is stable */
+static void settle(void)
+{
+    matrix_row_t prev[MATRIX_ROWS] = {0};
+    uint16_t stable = 0;
+    for (uint16_t scans = 0; scans < BOOTMAGIC_SETTLE_TIMEOUT; scans++) {
+        matrix_scan();
+
+        bool changed = false;
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+            matrix_row_t row = matrix_get_row(r);
+            if (row != prev[r]) {
+                prev[r] = row;
+                changed = true;
+            }
+        }
+        if (changed || debounce_active()) {
+            stable = 0;
+        } else if (++stable >= BOOTMAGIC_SETTLE_SCANS) {
+            break;
+        }
+        _delay_ms(1);
+    }
+}
+
 void bootmagic(void)
 {
     /* check signature */
@@ -19,9 +52,8 @@ void bootmagic(void)
     }
 
     /* do scans in case of bounce */
-    print("boogmagic scan: ... ");
-    uint8_t scan = 100;
-    while (scan--) { matrix_scan(); _delay_ms(10); }
+    print("bootmagic scan: ... ");
+    settle();
     print("done.\n");
 
     /* bootmagic skip */
@@ -81,6 +113,7 @@ void bootmagic(void)
         keymap_config.nkro = !keymap_config.nkro;
     }
     eeconfig_write_keymap(keymap_config.raw);
+    keymap_config_update();
 
 #ifdef NKRO_ENABLE
     keyboard_nkro = keymap_config.nkro;
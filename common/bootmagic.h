@@ -2,6 +2,20 @@
 #define BOOTMAGIC_H
 
 
+/*
+ * Matrix settle before checking keys: scan every 1ms until matrix stays same
+ * for BOOTMAGIC_SETTLE_SCANS scans with no key bouncing, or about
+ * BOOTMAGIC_SETTLE_TIMEOUT(ms) passes. SCANS should be longer than debounce
+ * of matrix driver counted in scans. Converter whose keyboard reports keys
+ * held at power-up late needs larger SCANS.
+ */
+#ifndef BOOTMAGIC_SETTLE_SCANS
+#define BOOTMAGIC_SETTLE_SCANS          20
+#endif
+#ifndef BOOTMAGIC_SETTLE_TIMEOUT
+#define BOOTMAGIC_SETTLE_TIMEOUT        1000
+#endif
+
 /* bootmagic salt key */
 #ifndef BOOTMAGIC_KEY_SALT
 #define BOOTMAGIC_KEY_SALT              KC_SPACE
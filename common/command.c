@@ -33,6 +33,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "led.h"
 #include "command.h"
 #include "backlight.h"
+#include "latency.h"
+#include "matrix_idle.h"
+#include "startup_trace.h"
 
 #ifdef MOUSEKEY_ENABLE
 #include "mousekey.h"
@@ -49,6 +52,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #   include "usbdrv.h"
 #endif
 
+#ifdef PROTOCOL_LUFA
+#   include "lufa.h"
+#endif
+
 
 static bool command_common(uint8_t code);
 static void command_common_help(void);
@@ -115,6 +122,9 @@ static void command_common_help(void)
     print("t:	print timer count\n");
     print("s:	print status\n");
     print("e:	print eeprom config\n");
+#ifdef LATENCY_TRACE
+    print("l:	print latency histogram\n");
+#endif
 #ifdef NKRO_ENABLE
     print("n:	toggle NKRO\n");
 #endif
@@ -296,6 +306,12 @@ static bool command_common(uint8_t code)
                   " AVR-LIBC: " __AVR_LIBC_VERSION_STRING__
                   " AVR_ARCH: avr" STR(__AVR_ARCH__) "\n");
             break;
+#ifdef LATENCY_TRACE
+        case KC_L: // print latency histogram and restart
+            latency_print();
+            latency_clear();
+            break;
+#endif
         case KC_T: // print timer
             print_val_hex32(timer_count);
             break;
@@ -304,6 +320,7 @@ static bool command_common(uint8_t code)
             print_val_hex8(host_keyboard_leds());
             print_val_hex8(keyboard_protocol);
             print_val_hex8(keyboard_idle);
+            print_val_hex16(get_suppressed_report_count());
 #ifdef PROTOCOL_PJRC
             print_val_hex8(UDCON);
             print_val_hex8(UDIEN);
@@ -317,6 +334,13 @@ static bool command_common(uint8_t code)
             print_val_hex8(usbSofCount);
 #   endif
 #endif
+
+#ifdef PROTOCOL_LUFA
+            print_val_hex16(lufa_report_dropped);
+            print_val_hex16(lufa_report_coalesced);
+#endif
+            matrix_idle_print();
+            startup_print();
             break;
 #ifdef NKRO_ENABLE
         case KC_N:
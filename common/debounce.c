@@ -0,0 +1,205 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "timer.h"
+#include "debug.h"
+#include "debounce.h"
+#include "latency.h"
+
+
+#if (DEBOUNCE > 0)
+static uint16_t last_time = 0;
+
+/* milliseconds since last call, saturated to fit in counter */
+static uint8_t debounce_elapsed(void)
+{
+    uint16_t now = timer_read();
+    uint16_t elapsed = TIMER_DIFF_16(now, last_time);
+    last_time = now;
+    return (elapsed > 0x7F ? 0x7F : elapsed);
+}
+#endif
+
+
+#if (DEBOUNCE == 0)
+void debounce_init(void) {}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    bool changed = false;
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (cooked[r] != raw[r]) {
+            cooked[r] = raw[r];
+            changed = true;
+        }
+    }
+    if (changed) LATENCY_MARK(LATENCY_DEBOUNCE);
+    return changed;
+}
+
+bool debounce_active(void) { return false; }
+
+
+#elif defined(DEBOUNCE_PER_ROW)
+/* remaining time of each row, 0 means row is stable */
+static uint8_t counters[MATRIX_ROWS];
+static matrix_row_t raw_last[MATRIX_ROWS];
+static uint8_t active = 0;
+
+void debounce_init(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        counters[r] = 0;
+        raw_last[r] = 0;
+    }
+    active = 0;
+    last_time = timer_read();
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    uint8_t elapsed = debounce_elapsed();
+    bool changed = false;
+    bool started = false;
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (raw[r] != raw_last[r]) {
+            if (counters[r]) {
+                dprintf("bounce!: row %u\n", r);
+            } else {
+                active++;
+                started = true;
+            }
+            raw_last[r] = raw[r];
+            counters[r] = DEBOUNCE;
+        } else if (counters[r]) {
+            if (counters[r] > elapsed) {
+                counters[r] -= elapsed;
+            } else {
+                counters[r] = 0;
+                active--;
+                if (cooked[r] != raw[r]) {
+                    cooked[r] = raw[r];
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (started) LATENCY_MARK(LATENCY_RAW);
+    if (changed) LATENCY_MARK(LATENCY_DEBOUNCE);
+    return changed;
+}
+
+bool debounce_active(void) { return active; }
+
+
+#else
+/* remaining time of each key, 0 means key is stable */
+static uint8_t counters[MATRIX_ROWS][MATRIX_COLS];
+/* keys with counter running, to skip idle rows quickly */
+static matrix_row_t counting[MATRIX_ROWS];
+#ifdef DEBOUNCE_EAGER_PRESS
+/* keys locked after eager press, others in counting are waiting release */
+static matrix_row_t locked[MATRIX_ROWS];
+#endif
+
+void debounce_init(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+            counters[r][c] = 0;
+        }
+        counting[r] = 0;
+#ifdef DEBOUNCE_EAGER_PRESS
+        locked[r] = 0;
+#endif
+    }
+    last_time = timer_read();
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[])
+{
+    uint8_t elapsed = debounce_elapsed();
+    bool changed = false;
+    bool started = false;
+
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_t delta = raw[r] ^ cooked[r];
+        if (!(delta | counting[r])) continue;
+
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+            matrix_row_t bit = ((matrix_row_t)1<<c);
+            uint8_t *counter = &counters[r][c];
+
+            if (counting[r] & bit) {
+#ifdef DEBOUNCE_EAGER_PRESS
+                if (locked[r] & bit) {
+                    // ignore any change until lock expires
+                    if (*counter > elapsed) {
+                        *counter -= elapsed;
+                        continue;
+                    }
+                    locked[r] &= ~bit;
+                    counting[r] &= ~bit;
+                    // fall through to see release in this scan
+                } else
+#endif
+                if (!(delta & bit)) {
+                    // bounced back to registered state
+                    dprintf("bounce!: %02X%02X\n", r, c);
+                    counting[r] &= ~bit;
+                    continue;
+                } else if (*counter > elapsed) {
+                    *counter -= elapsed;
+                    continue;
+                } else {
+                    counting[r] &= ~bit;
+                    cooked[r] ^= bit;
+                    changed = true;
+                    continue;
+                }
+            }
+
+            if (delta & bit) {
+#ifdef DEBOUNCE_EAGER_PRESS
+                if (raw[r] & bit) {
+                    cooked[r] |= bit;
+                    changed = true;
+                    locked[r] |= bit;
+                }
+#endif
+                *counter = DEBOUNCE;
+                counting[r] |= bit;
+                started = true;
+            }
+        }
+    }
+    if (started) LATENCY_MARK(LATENCY_RAW);
+    if (changed) LATENCY_MARK(LATENCY_DEBOUNCE);
+    return changed;
+}
+
+bool debounce_active(void)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        if (counting[r]) return true;
+    }
+    return false;
+}
+#endif
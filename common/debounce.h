@@ -0,0 +1,57 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+
+
+/*
+ * Debounce for matrix drivers
+ *
+ * DEBOUNCE is debounce time in milliseconds(0: no debounce). Algorithm is
+ * selected in config.h:
+ *
+ *   default                  symmetric defer per key
+ *                            Change of a key is registered after it is stable for DEBOUNCE.
+ *   DEBOUNCE_EAGER_PRESS     eager press, deferred release per key
+ *                            Press is registered immediately and then the key is locked
+ *                            for DEBOUNCE. Release is registered after stable for DEBOUNCE.
+ *   DEBOUNCE_PER_ROW         symmetric defer per row
+ *                            Row is registered after it is stable for DEBOUNCE. Uses less RAM.
+ *
+ * Matrix driver passes its raw scan result and debounced matrix every matrix_scan().
+ * This never waits, timing is based on timer_read().
+ */
+#ifndef DEBOUNCE
+#   define DEBOUNCE 5
+#endif
+
+#if (DEBOUNCE > 127)
+#   error "DEBOUNCE must not exceed 127"
+#endif
+
+
+void debounce_init(void);
+/* update debounced matrix with raw matrix. returns true when debounced matrix changes */
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[]);
+/* whether any key is bouncing now */
+bool debounce_active(void);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "debug.h"
+#include "defer.h"
+
+
+typedef struct {
+    defer_func_t func;  /* NULL: free slot */
+    uint16_t time;
+    uint16_t delay;
+    uint8_t arg;
+} defer_t;
+
+static defer_t defers[DEFER_SIZE] = {};
+
+
+bool defer_exec(uint16_t delay, defer_func_t func, uint8_t arg)
+{
+    for (uint8_t i = 0; i < DEFER_SIZE; i++) {
+        if (defers[i].func) continue;
+        defers[i] = (defer_t){ .func = func, .time = timer_read(), .delay = delay, .arg = arg };
+        return true;
+    }
+    debug("defer: full\n");
+    return false;
+}
+
+void defer_cancel(defer_func_t func)
+{
+    for (uint8_t i = 0; i < DEFER_SIZE; i++) {
+        if (defers[i].func == func) defers[i].func = 0;
+    }
+}
+
+bool defer_pending(defer_func_t func)
+{
+    for (uint8_t i = 0; i < DEFER_SIZE; i++) {
+        if (defers[i].func == func) return true;
+    }
+    return false;
+}
+
+void defer_task(void)
+{
+    for (uint8_t i = 0; i < DEFER_SIZE; i++) {
+        if (!defers[i].func) continue;
+        if (timer_elapsed(defers[i].time) < defers[i].delay) continue;
+
+        // free slot before call so that func can schedule again
+        defer_func_t func = defers[i].func;
+        uint8_t arg = defers[i].arg;
+        defers[i].func = 0;
+        func(arg);
+    }
+}
+
+void defer_clear(void)
+{
+    for (uint8_t i = 0; i < DEFER_SIZE; i++) {
+        defers[i].func = 0;
+    }
+}
@@ -0,0 +1,56 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DEFER_H
+#define DEFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Deferred execution
+ *
+ * defer_exec() schedules a function to be called from main loop after delay
+ * instead of waiting with _delay_ms(), so that timed jobs like release of
+ * a tapped button don't stall matrix scan. defer_task() is called from
+ * keyboard_task(). A function can schedule itself again to run a sequence.
+ */
+typedef void (*defer_func_t)(uint8_t arg);
+
+/* number of pending calls */
+#ifndef DEFER_SIZE
+#define DEFER_SIZE  4
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* call func(arg) after delay ms. returns false when no slot is free */
+bool defer_exec(uint16_t delay, defer_func_t func, uint8_t arg);
+/* remove pending calls of func */
+void defer_cancel(defer_func_t func);
+bool defer_pending(defer_func_t func);
+void defer_task(void);
+void defer_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
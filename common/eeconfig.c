@@ -3,16 +3,153 @@
 #include <avr/eeprom.h>
 #include "eeconfig.h"
 
+#ifdef EECONFIG_CACHE
+#include "timer.h"
+
+/*
+ * Setting bytes(EECONFIG_DEBUG..EECONFIG_BACKLIGHT) are kept in RAM and saved
+ * as a record in next slot of ring at EECONFIG_CACHE_ADDR. Sequence number is
+ * written last so that record interrupted by power loss fails checksum.
+ */
+#define FIRST_ADDR  2   /* EECONFIG_DEBUG */
+#define DATA_SIZE   5   /* to EECONFIG_BACKLIGHT */
+
+typedef struct {
+    uint8_t seq;
+    uint8_t data[DATA_SIZE];
+    uint8_t sum;
+} eeconfig_record_t;
+
+#define SLOT(i)     ((uint8_t *)(EECONFIG_CACHE_ADDR + (i) * sizeof(eeconfig_record_t)))
+
+static uint8_t cache[DATA_SIZE];
+static uint8_t stored[DATA_SIZE];   /* data of newest record */
+static uint8_t slot;                /* slot of newest record */
+static uint8_t seq;
+static bool loaded = false;
+static bool dirty = false;
+static uint16_t dirty_time;
+
+/* record being written; out_pos is byte of record to write next */
+static eeconfig_record_t out;
+static uint8_t out_pos = sizeof(eeconfig_record_t);
+
+static uint8_t record_sum(const eeconfig_record_t *r)
+{
+    uint8_t sum = r->seq;
+    for (uint8_t i = 0; i < DATA_SIZE; i++) sum += r->data[i];
+    return ~sum;
+}
+
+static bool read_record(uint8_t i, eeconfig_record_t *r)
+{
+    eeprom_read_block(r, SLOT(i), sizeof(eeconfig_record_t));
+    return r->sum == record_sum(r);
+}
+
+static void load(void)
+{
+    eeconfig_record_t r;
+    bool found = false;
+    for (uint8_t i = 0; i < EECONFIG_CACHE_SLOTS; i++) {
+        if (!read_record(i, &r)) continue;
+        /* newest record is not followed by record with next sequence number */
+        uint8_t next_seq = r.seq + 1;
+        eeconfig_record_t n;
+        if (read_record((i + 1) % EECONFIG_CACHE_SLOTS, &n) && n.seq == next_seq) continue;
+        if (found && (int8_t)(r.seq - seq) < 0) continue;
+        found = true;
+        slot = i;
+        seq = r.seq;
+        for (uint8_t j = 0; j < DATA_SIZE; j++) stored[j] = r.data[j];
+    }
+    if (!found) {
+        /* settings written without cache */
+        slot = EECONFIG_CACHE_SLOTS - 1;
+        seq = 0xFF;
+        for (uint8_t j = 0; j < DATA_SIZE; j++) {
+            stored[j] = eeprom_read_byte(EECONFIG_DEBUG + j);
+        }
+    }
+    for (uint8_t j = 0; j < DATA_SIZE; j++) cache[j] = stored[j];
+    loaded = true;
+}
+
+static uint8_t read_byte(uint8_t *addr)
+{
+    if (!loaded) load();
+    return cache[(uintptr_t)addr - FIRST_ADDR];
+}
+
+static void write_byte(uint8_t *addr, uint8_t val)
+{
+    if (!loaded) load();
+    uint8_t i = (uintptr_t)addr - FIRST_ADDR;
+    if (cache[i] == val) return;
+    cache[i] = val;
+    dirty = true;
+    dirty_time = timer_read();
+}
+
+static void start_flush(void)
+{
+    dirty = false;
+    bool changed = false;
+    for (uint8_t j = 0; j < DATA_SIZE; j++) {
+        if (stored[j] != cache[j]) changed = true;
+        out.data[j] = stored[j] = cache[j];
+    }
+    if (!changed) return;
+
+    slot = (slot + 1) % EECONFIG_CACHE_SLOTS;
+    out.seq = ++seq;
+    out.sum = record_sum(&out);
+    out_pos = 0;
+}
+
+/* write one byte; data and sum first, seq last */
+static void write_next(void)
+{
+    uint8_t i = (out_pos + 1) % sizeof(eeconfig_record_t);
+    eeprom_write_byte(SLOT(slot) + i, ((uint8_t *)&out)[i]);
+    out_pos++;
+}
+
+void eeconfig_task(void)
+{
+    if (out_pos < sizeof(eeconfig_record_t)) {
+        if (eeprom_is_ready()) write_next();
+        return;
+    }
+    if (dirty && timer_elapsed(dirty_time) >= EECONFIG_CACHE_DELAY) {
+        start_flush();
+    }
+}
+
+void eeconfig_flush(void)
+{
+    if (dirty) start_flush();
+    while (out_pos < sizeof(eeconfig_record_t)) write_next();
+    eeprom_busy_wait();
+}
+
+#else
+#define read_byte(addr)         eeprom_read_byte(addr)
+#define write_byte(addr, val)   eeprom_write_byte(addr, val)
+#endif
+
+/* magic is written last so that power loss before it leaves EEPROM uninitialized */
 void eeconfig_init(void)
 {
-    eeprom_write_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
-    eeprom_write_byte(EECONFIG_DEBUG,          0);
-    eeprom_write_byte(EECONFIG_DEFAULT_LAYER,  0);
-    eeprom_write_byte(EECONFIG_KEYMAP,         0);
-    eeprom_write_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
+    write_byte(EECONFIG_DEBUG,          0);
+    write_byte(EECONFIG_DEFAULT_LAYER,  0);
+    write_byte(EECONFIG_KEYMAP,         0);
+    write_byte(EECONFIG_MOUSEKEY_ACCEL, 0);
 #ifdef BACKLIGHT_ENABLE
-    eeprom_write_byte(EECONFIG_BACKLIGHT,      0);
+    write_byte(EECONFIG_BACKLIGHT,      0);
 #endif
+    eeconfig_flush();
+    eeprom_write_word(EECONFIG_MAGIC,          EECONFIG_MAGIC_NUMBER);
 }
 
 void eeconfig_enable(void)
@@ -30,16 +167,16 @@ bool eeconfig_is_enabled(void)
     return (eeprom_read_word(EECONFIG_MAGIC) == EECONFIG_MAGIC_NUMBER);
 }
 
-uint8_t eeconfig_read_debug(void)      { return eeprom_read_byte(EECONFIG_DEBUG); }
-void eeconfig_write_debug(uint8_t val) { eeprom_write_byte(EECONFIG_DEBUG, val); }
+uint8_t eeconfig_read_debug(void)      { return read_byte(EECONFIG_DEBUG); }
+void eeconfig_write_debug(uint8_t val) { write_byte(EECONFIG_DEBUG, val); }
 
-uint8_t eeconfig_read_default_layer(void)      { return eeprom_read_byte(EECONFIG_DEFAULT_LAYER); }
-void eeconfig_write_default_layer(uint8_t val) { eeprom_write_byte(EECONFIG_DEFAULT_LAYER, val); }
+uint8_t eeconfig_read_default_layer(void)      { return read_byte(EECONFIG_DEFAULT_LAYER); }
+void eeconfig_write_default_layer(uint8_t val) { write_byte(EECONFIG_DEFAULT_LAYER, val); }
 
-uint8_t eeconfig_read_keymap(void)      { return eeprom_read_byte(EECONFIG_KEYMAP); }
-void eeconfig_write_keymap(uint8_t val) { eeprom_write_byte(EECONFIG_KEYMAP, val); }
+uint8_t eeconfig_read_keymap(void)      { return read_byte(EECONFIG_KEYMAP); }
+void eeconfig_write_keymap(uint8_t val) { write_byte(EECONFIG_KEYMAP, val); }
 
 #ifdef BACKLIGHT_ENABLE
-uint8_t eeconfig_read_backlight(void)      { return eeprom_read_byte(EECONFIG_BACKLIGHT); }
-void eeconfig_write_backlight(uint8_t val) { eeprom_write_byte(EECONFIG_BACKLIGHT, val); }
+uint8_t eeconfig_read_backlight(void)      { return read_byte(EECONFIG_BACKLIGHT); }
+void eeconfig_write_backlight(uint8_t val) { write_byte(EECONFIG_BACKLIGHT, val); }
 #endif
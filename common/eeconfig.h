@@ -32,6 +32,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EECONFIG_MOUSEKEY_ACCEL                     (uint8_t *)5
 #define EECONFIG_BACKLIGHT                          (uint8_t *)6
 
+/*
+ * Write-back cache(define EECONFIG_CACHE in config.h)
+ *
+ * Writes only change RAM copy and the settings are saved EECONFIG_CACHE_DELAY(ms)
+ * after last change by eeconfig_task() one byte at a time without waiting
+ * for EEPROM, or by eeconfig_flush() on suspend. Each save goes to next of
+ * EECONFIG_CACHE_SLOTS records at EECONFIG_CACHE_ADDR to spread wear. Change
+ * not saved yet is lost at power off.
+ */
+#ifndef EECONFIG_CACHE_ADDR
+#define EECONFIG_CACHE_ADDR                         8
+#endif
+#ifndef EECONFIG_CACHE_SLOTS
+#define EECONFIG_CACHE_SLOTS                        16
+#endif
+#ifndef EECONFIG_CACHE_DELAY
+#define EECONFIG_CACHE_DELAY                        3000
+#endif
+#if (EECONFIG_CACHE_SLOTS < 2 || EECONFIG_CACHE_SLOTS > 128)
+#   error "EECONFIG_CACHE_SLOTS must be 2-128"
+#endif
+
 
 /* debug bit */
 #define EECONFIG_DEBUG_ENABLE                       (1<<0)
@@ -72,4 +94,14 @@ uint8_t eeconfig_read_backlight(void);
 void eeconfig_write_backlight(uint8_t val);
 #endif
 
+#ifdef EECONFIG_CACHE
+/* save changed settings after delay, call repeatedly */
+void eeconfig_task(void);
+/* save changed settings now and wait for EEPROM */
+void eeconfig_flush(void);
+#else
+#define eeconfig_task()
+#define eeconfig_flush()
+#endif
+
 #endif
@@ -21,6 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "latency.h"
+#include "trace.h"
+#include "startup_trace.h"
 
 
 #ifdef NKRO_ENABLE
@@ -51,7 +54,12 @@ uint8_t host_keyboard_leds(void)
 void host_keyboard_send(report_keyboard_t *report)
 {
     if (!driver) return;
+    LATENCY_MARK(LATENCY_HOST_SEND);
     (*driver->send_keyboard)(report);
+    STARTUP_MARK(STARTUP_FIRST_REPORT);
+    TRACE(TRACE_KEYBOARD_REPORT, report->mods,
+          (uint32_t)report->keys[0]<<24 | (uint32_t)report->keys[1]<<16 |
+          (uint32_t)report->keys[2]<<8 | report->keys[3]);
 
     if (debug_keyboard) {
         dprint("keyboard_report: ");
@@ -95,3 +103,10 @@ uint16_t host_last_consumer_report(void)
 {
     return last_consumer_report;
 }
+
+/* Driver which queues reports overrides this to tell its queue is full. */
+__attribute__ ((weak))
+bool host_send_busy(void)
+{
+    return false;
+}
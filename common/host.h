@@ -50,6 +50,9 @@ void host_consumer_send(uint16_t data);
 uint16_t host_last_sysytem_report(void);
 uint16_t host_last_consumer_report(void);
 
+/* true while driver has no room for another keyboard or extra report */
+bool host_send_busy(void);
+
 #ifdef __cplusplus
 }
 #endif
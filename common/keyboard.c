@@ -31,6 +31,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "bootmagic.h"
 #include "eeconfig.h"
 #include "backlight.h"
+#include "latency.h"
+#include "trace.h"
+#include "startup_trace.h"
+#include "defer.h"
+#ifdef MATRIX_EVENT_QUEUE
+#   include "matrix_event.h"
+#endif
 #ifdef MOUSEKEY_ENABLE
 #   include "mousekey.h"
 #endif
@@ -59,21 +66,80 @@ static bool has_ghost_in_row(uint8_t row)
 }
 #endif
 
+#ifdef MATRIX_EVENT_QUEUE
+/* key state processed so far, to recover events lost in queue overflow */
+static matrix_row_t matrix_state[MATRIX_ROWS];
+
+static void matrix_event_exec(keyevent_t event)
+{
+    if (event.pressed)
+        matrix_state[event.key.row] |= ((matrix_row_t)1<<event.key.col);
+    else
+        matrix_state[event.key.row] &= ~((matrix_row_t)1<<event.key.col);
+    action_exec(event);
+}
+
+/* process difference between matrix and processed state, returns false if none */
+static bool matrix_event_resync(void)
+{
+    bool has_event = false;
+    dprint("matrix_event: resync\n");
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
+        matrix_row_t matrix_row = matrix_get_row(r);
+        matrix_row_t matrix_change = matrix_row ^ matrix_state[r];
+        for (uint8_t c = 0; c < MATRIX_COLS; c++) {
+            if (matrix_change & ((matrix_row_t)1<<c)) {
+                matrix_event_exec((keyevent_t){
+                    .key = (key_t){ .row = r, .col = c },
+                    .pressed = (matrix_row & ((matrix_row_t)1<<c)),
+                    .time = (timer_read() | 1) /* time should not be 0 */
+                });
+                has_event = true;
+            }
+        }
+    }
+    return has_event;
+}
+
+/* process key events queued by matrix driver instead of diffing matrix */
+static void matrix_event_task(void)
+{
+    keyevent_t event;
+    if (!matrix_event_get(&event)) {
+        if (matrix_event_overflowed() && matrix_event_resync()) return;
+        // call with pseudo tick event when no real key event.
+        action_exec(TICK);
+        return;
+    }
+    if (debug_matrix) matrix_print();
+    matrix_event_exec(event);
+#ifdef MATRIX_BATCH_EVENTS
+    while (matrix_event_get(&event)) {
+        matrix_event_exec(event);
+    }
+#endif
+}
+#endif
+
 
 void keyboard_init(void)
 {
     timer_init();
     matrix_init();
+    STARTUP_MARK(STARTUP_MATRIX_INIT);
 #ifdef PS2_MOUSE_ENABLE
     ps2_mouse_init();
+    STARTUP_MARK(STARTUP_MOUSE_INIT);
 #endif
 #ifdef SERIAL_MOUSE_ENABLE
     serial_mouse_init();
+    STARTUP_MARK(STARTUP_MOUSE_INIT);
 #endif
 
 
 #ifdef BOOTMAGIC_ENABLE
     bootmagic();
+    STARTUP_MARK(STARTUP_BOOTMAGIC);
 #endif
 
 #ifdef BACKLIGHT_ENABLE
@@ -87,17 +153,33 @@ void keyboard_init(void)
  */
 void keyboard_task(void)
 {
-    static matrix_row_t matrix_prev[MATRIX_ROWS];
     static uint8_t led_status = 0;
+#ifndef MATRIX_EVENT_QUEUE
+    static matrix_row_t matrix_prev[MATRIX_ROWS];
     matrix_row_t matrix_row = 0;
     matrix_row_t matrix_change = 0;
+#ifdef MATRIX_BATCH_EVENTS
+    bool has_event = false;
+#endif
+#endif
 
+    LATENCY_MARK(LATENCY_SCAN_START);
     matrix_scan();
+    LATENCY_MARK(LATENCY_SCAN_END);
+    STARTUP_MARK(STARTUP_FIRST_SCAN);
+#ifdef MATRIX_EVENT_QUEUE
+    // events wait in queue while host cannot take a report
+    if (!host_send_busy()) matrix_event_task();
+#else
+    // changes wait in matrix while host cannot take a report
+    if (host_send_busy()) goto MATRIX_LOOP_END;
+
     for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
         matrix_row = matrix_get_row(r);
         matrix_change = matrix_row ^ matrix_prev[r];
         if (matrix_change) {
             if (debug_matrix) matrix_print();
+            TRACE(TRACE_MATRIX, r, matrix_row);
 #ifdef MATRIX_HAS_GHOST
             if (has_ghost_in_row(r)) {
                 matrix_prev[r] = matrix_row;
@@ -113,16 +195,32 @@ void keyboard_task(void)
                     });
                     // record a processed key
                     matrix_prev[r] ^= ((matrix_row_t)1<<c);
+#ifdef MATRIX_BATCH_EVENTS
+                    // process all changed keys of this scan in row/col order
+                    has_event = true;
+#else
                     // process a key per task call
                     goto MATRIX_LOOP_END;
+#endif
                 }
             }
         }
     }
+#ifdef MATRIX_BATCH_EVENTS
+    if (!has_event) {
+        // call with pseudo tick event when no real key event.
+        action_exec(TICK);
+    }
+#else
     // call with pseudo tick event when no real key event.
     action_exec(TICK);
+#endif
 
 MATRIX_LOOP_END:
+#endif
+
+    // timed jobs scheduled with defer_exec()
+    defer_task();
 
 #ifdef MOUSEKEY_ENABLE
     // mousekey repeat & acceleration
@@ -142,6 +240,11 @@ MATRIX_LOOP_END:
         led_status = host_keyboard_leds();
         keyboard_set_leds(led_status);
     }
+
+    // save settings changed in eeconfig cache
+    eeconfig_task();
+
+    latency_task();
 }
 
 void keyboard_set_leds(uint8_t leds)
@@ -29,78 +29,90 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 static action_t keycode_to_action(uint8_t keycode);
 
 
+#ifdef BOOTMAGIC_ENABLE
+/*
+ * Keycode remap overlay
+ *      Built from keymap_config by keymap_config_update() so that swap options
+ *      are not evaluated on every event. remap_bits marks keycodes to be replaced.
+ */
+#define REMAP_MAX 12
+static uint8_t remap_bits[32];
+static struct {
+    uint8_t from;
+    uint8_t to;
+} remap[REMAP_MAX];
+static uint8_t remap_count = 0;
+
+static void remap_add(uint8_t from, uint8_t to)
+{
+    if (remap_count >= REMAP_MAX) return;
+    remap_bits[from>>3] |= 1<<(from&7);
+    remap[remap_count].from = from;
+    remap[remap_count].to = to;
+    remap_count++;
+}
+
+static uint8_t remap_keycode(uint8_t keycode)
+{
+    if (!(remap_bits[keycode>>3] & (1<<(keycode&7)))) {
+        return keycode;
+    }
+    for (uint8_t i = 0; i < remap_count; i++) {
+        if (remap[i].from == keycode) {
+            return remap[i].to;
+        }
+    }
+    return keycode;
+}
+
+void keymap_config_update(void)
+{
+    for (uint8_t i = 0; i < sizeof(remap_bits); i++) {
+        remap_bits[i] = 0;
+    }
+    remap_count = 0;
+
+    if (keymap_config.swap_control_capslock || keymap_config.capslock_to_control) {
+        remap_add(KC_CAPSLOCK, KC_LCTL);
+        remap_add(KC_LOCKING_CAPS, KC_LCTL);
+    }
+    if (keymap_config.swap_control_capslock) {
+        remap_add(KC_LCTL, KC_CAPSLOCK);
+    }
+    if (keymap_config.swap_lalt_lgui) {
+        remap_add(KC_LALT, keymap_config.no_gui ? KC_NO : KC_LGUI);
+        remap_add(KC_LGUI, KC_LALT);
+    } else if (keymap_config.no_gui) {
+        remap_add(KC_LGUI, KC_NO);
+    }
+    if (keymap_config.swap_ralt_rgui) {
+        remap_add(KC_RALT, keymap_config.no_gui ? KC_NO : KC_RGUI);
+        remap_add(KC_RGUI, KC_RALT);
+    } else if (keymap_config.no_gui) {
+        remap_add(KC_RGUI, KC_NO);
+    }
+    if (keymap_config.swap_grave_esc) {
+        remap_add(KC_GRAVE, KC_ESC);
+        remap_add(KC_ESC, KC_GRAVE);
+    }
+    if (keymap_config.swap_backslash_backspace) {
+        remap_add(KC_BSLASH, KC_BSPACE);
+        remap_add(KC_BSPACE, KC_BSLASH);
+    }
+}
+#endif
+
+
 /* converts key to action */
 action_t action_for_key(uint8_t layer, key_t key)
 {
     uint8_t keycode = keymap_key_to_keycode(layer, key);
+#ifdef BOOTMAGIC_ENABLE
+    keycode = remap_keycode(keycode);
+#endif
     switch (keycode) {
         case KC_FN0 ... KC_FN31:
             return keymap_fn_to_action(keycode);
-#ifdef BOOTMAGIC_ENABLE
-        case KC_CAPSLOCK:
-        case KC_LOCKING_CAPS:
-            if (keymap_config.swap_control_capslock || keymap_config.capslock_to_control) {
-                return keycode_to_action(KC_LCTL);
-            }
-            return keycode_to_action(keycode);
-        case KC_LCTL:
-            if (keymap_config.swap_control_capslock) {
-                return keycode_to_action(KC_CAPSLOCK);
-            }
-            return keycode_to_action(KC_LCTL);
-        case KC_LALT:
-            if (keymap_config.swap_lalt_lgui) {
-                if (keymap_config.no_gui) {
-                    return keycode_to_action(ACTION_NO);
-                }
-                return keycode_to_action(KC_LGUI);
-            }
-            return keycode_to_action(KC_LALT);
-        case KC_LGUI:
-            if (keymap_config.swap_lalt_lgui) {
-                return keycode_to_action(KC_LALT);
-            }
-            if (keymap_config.no_gui) {
-                return keycode_to_action(ACTION_NO);
-            }
-            return keycode_to_action(KC_LGUI);
-        case KC_RALT:
-            if (keymap_config.swap_ralt_rgui) {
-                if (keymap_config.no_gui) {
-                    return keycode_to_action(ACTION_NO);
-                }
-                return keycode_to_action(KC_RGUI);
-            }
-            return keycode_to_action(KC_RALT);
-        case KC_RGUI:
-            if (keymap_config.swap_ralt_rgui) {
-                return keycode_to_action(KC_RALT);
-            }
-            if (keymap_config.no_gui) {
-                return keycode_to_action(ACTION_NO);
-            }
-            return keycode_to_action(KC_RGUI);
-        case KC_GRAVE:
-            if (keymap_config.swap_grave_esc) {
-                return keycode_to_action(KC_ESC);
-            }
-            return keycode_to_action(KC_GRAVE);
-        case KC_ESC:
-            if (keymap_config.swap_grave_esc) {
-                return keycode_to_action(KC_GRAVE);
-            }
-            return keycode_to_action(KC_ESC);
-        case KC_BSLASH:
-            if (keymap_config.swap_backslash_backspace) {
-                return keycode_to_action(KC_BSPACE);
-            }
-            return keycode_to_action(KC_BSLASH);
-        case KC_BSPACE:
-            if (keymap_config.swap_backslash_backspace) {
-                return keycode_to_action(KC_BSLASH);
-            }
-            return keycode_to_action(KC_BSPACE);
-#endif
         case KC_GRAVE:
             if (get_mods() & MOD_BIT(KC_LALT)) {
 	        //LALT pressed, delete LALT
@@ -39,6 +39,9 @@ typedef union {
     };
 } keymap_config_t;
 keymap_config_t keymap_config;
+
+/* apply keymap_config to keycode remap. call when keymap_config is changed */
+void keymap_config_update(void);
 #endif
 
 
@@ -0,0 +1,111 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef KEYMAP_SPARSE_H
+#define KEYMAP_SPARSE_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "keycode.h"
+#include "keyboard.h"
+#include "util.h"
+
+
+/*
+ * Sparse keymap for converters
+ *
+ * Converter matrix is scan code itself(row: code>>3, col: code&7) and most
+ * of MATRIX_ROWS*MATRIX_COLS grid has no key. Layer of sparse keymap holds
+ * KEYMAP_CODES keycodes only for codes which exist, in order of scan code.
+ *
+ * Converter provides two tables of MATRIX_ROWS bytes:
+ *      keymap_codes[row]   bit col is on when code row*8+col exists
+ *      keymap_ranks[row]   number of existent codes less than row*8
+ * and defines KEYMAP_CODES before including this file. keymap_sparse test in
+ * protocol/sim/test checks them against KEYMAP macro of the converter.
+ *
+ * Keymap provides keymaps[][KEYMAP_CODES] and keymap_overlays[]. Layers after
+ * the last of keymaps[] are overlay layers; only keys listed in
+ * keymap_overlays[] are defined on them and others are KC_TRNS. Entries must be
+ * sorted by layer and then by code. Each entry costs three bytes so that a
+ * layer changing a few keys doesn't take a whole KEYMAP_CODES.
+ *
+ *      const uint8_t PROGMEM keymaps[][KEYMAP_CODES] = { KEYMAP(...), };
+ *      const keymap_overlay_t PROGMEM keymap_overlays[] = {
+ *          KEYMAP_OVERLAY(1, 0x1D, UP),
+ *      };
+ *      KEYMAP_SPARSE_SIZE;
+ */
+#if MATRIX_COLS != 8
+#   error "Sparse keymap requires MATRIX_COLS 8."
+#endif
+#ifndef KEYMAP_CODES
+#   error "KEYMAP_CODES is not defined."
+#endif
+
+typedef struct {
+    uint8_t layer;
+    uint8_t code;
+    uint8_t keycode;
+} keymap_overlay_t;
+
+#define KEYMAP_OVERLAY(layer, code, key)    { layer, code, KC_##key }
+
+#define KEYMAP_SPARSE_SIZE \
+    const uint8_t PROGMEM keymaps_size = sizeof(keymaps) / sizeof(keymaps[0]); \
+    const uint16_t PROGMEM keymap_overlays_size = sizeof(keymap_overlays) / sizeof(keymap_overlays[0])
+
+extern const uint8_t keymap_codes[MATRIX_ROWS];
+extern const uint8_t keymap_ranks[MATRIX_ROWS];
+
+extern const uint8_t keymaps[][KEYMAP_CODES];
+extern const keymap_overlay_t keymap_overlays[];
+extern const uint8_t keymaps_size;
+extern const uint16_t keymap_overlays_size;
+
+
+/* binary search on overlay entries */
+static inline uint8_t keymap_overlay_keycode(uint8_t layer, uint8_t code)
+{
+    uint16_t want = (layer<<8) | code;
+    uint16_t lo = 0;
+    uint16_t hi = pgm_read_word(&keymap_overlays_size);
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+        uint16_t k = (pgm_read_byte(&keymap_overlays[mid].layer)<<8) |
+                      pgm_read_byte(&keymap_overlays[mid].code);
+        if (k == want) return pgm_read_byte(&keymap_overlays[mid].keycode);
+        if (k < want)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return KC_TRNS;
+}
+
+static inline uint8_t keymap_sparse_keycode(uint8_t layer, key_t key)
+{
+    uint8_t bits = pgm_read_byte(&keymap_codes[key.row]);
+    if (!(bits & (1<<key.col))) return KC_NO;
+
+    if (layer < pgm_read_byte(&keymaps_size)) {
+        uint8_t i = pgm_read_byte(&keymap_ranks[key.row]) + bitpop(bits & ((1<<key.col) - 1));
+        return pgm_read_byte(&keymaps[layer][i]);
+    }
+    return keymap_overlay_keycode(layer, key.row<<3 | key.col);
+}
+
+#endif
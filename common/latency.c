@@ -0,0 +1,207 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "timer.h"
+#include "print.h"
+#include "latency.h"
+
+
+typedef struct {
+    uint32_t time;
+    uint8_t  stage;
+} latency_trace_t;
+
+/* marks may come from interrupt(endpoint) */
+static latency_trace_t trace[LATENCY_TRACE_SIZE];
+static volatile uint8_t trace_head = 0;
+static uint8_t trace_tail = 0;
+static uint16_t trace_dropped = 0;
+
+static uint16_t histogram[LATENCY_STAGES][LATENCY_BUCKETS];
+static uint16_t count[LATENCY_STAGES];
+static uint16_t min[LATENCY_STAGES];
+static uint16_t max[LATENCY_STAGES];
+
+/* current key event */
+static uint32_t scan_start = 0;
+static uint32_t event_start = 0;
+static uint32_t event_scan = 0;
+static bool event_open = false;
+static uint8_t event_done = 0;   /* stages already recorded for event */
+
+/* raw changes not settled yet: oldest one and next one after it */
+static uint32_t raw_first = 0;
+static uint32_t raw_next = 0;
+static uint8_t raw_pending = 0;
+/* raw change older than this is bounce which settled without change */
+#define RAW_STALE_US    ((uint32_t)LATENCY_BUCKET_US * LATENCY_BUCKETS)
+
+#define BUCKET_US(stage)    ((stage) == LATENCY_SCAN ? LATENCY_SCAN_BUCKET_US : LATENCY_BUCKET_US)
+
+
+void latency_mark(uint8_t stage)
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t next = (trace_head + 1) % LATENCY_TRACE_SIZE;
+    if (next == trace_tail) {
+        trace_dropped++;
+    } else {
+        trace[trace_head].time = timer_read_us();
+        trace[trace_head].stage = stage;
+        trace_head = next;
+    }
+    SREG = sreg;
+}
+
+static void record(uint8_t stage, uint32_t us)
+{
+    uint32_t bucket = us / BUCKET_US(stage);
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    if (us > UINT16_MAX) us = UINT16_MAX;
+    if (!count[stage] || us < min[stage]) min[stage] = us;
+    if (!count[stage] || us > max[stage]) max[stage] = us;
+    if (histogram[stage][bucket] < UINT16_MAX) histogram[stage][bucket]++;
+    if (count[stage] < UINT16_MAX) count[stage]++;
+}
+
+/* start of key event settled now: its raw change if known, or this scan */
+static uint32_t raw_start(uint32_t now)
+{
+    uint32_t start = scan_start;
+    if (raw_pending && now - raw_first < RAW_STALE_US) start = raw_first;
+    if (raw_pending) raw_pending--;
+    raw_first = raw_next;
+    return start;
+}
+
+void latency_task(void)
+{
+    while (trace_tail != trace_head) {
+        latency_trace_t t = trace[trace_tail];
+        trace_tail = (trace_tail + 1) % LATENCY_TRACE_SIZE;
+
+        switch (t.stage) {
+            case LATENCY_SCAN_START:
+                scan_start = t.time;
+                break;
+            case LATENCY_SCAN_END:
+                record(LATENCY_SCAN, t.time - scan_start);
+                break;
+            case LATENCY_RAW:
+                if (raw_pending && t.time - raw_first >= RAW_STALE_US) raw_pending = 0;
+                if (raw_pending == 0) raw_first = scan_start;
+                if (raw_pending == 1) raw_next = scan_start;
+                if (raw_pending < 2) raw_pending++;
+                break;
+            case LATENCY_DEBOUNCE:
+            case LATENCY_ACTION_EXEC:
+                /* new key event begins at first mark after scan start */
+                if (!event_open || event_scan != scan_start) {
+                    event_open = true;
+                    event_scan = scan_start;
+                    event_start = (t.stage == LATENCY_DEBOUNCE ? raw_start(t.time) : scan_start);
+                    event_done = 0;
+                }
+                /* fall through */
+            default:
+                if (event_open && !(event_done & (1<<t.stage))) {
+                    event_done |= (1<<t.stage);
+                    record(t.stage, t.time - event_start);
+                }
+                break;
+        }
+    }
+}
+
+void latency_clear(void)
+{
+    for (uint8_t s = 0; s < LATENCY_STAGES; s++) {
+        count[s] = 0;
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            histogram[s][b] = 0;
+        }
+    }
+    trace_dropped = 0;
+    event_open = false;
+    raw_pending = 0;
+}
+
+uint16_t latency_samples(uint8_t stage)
+{
+    return count[stage];
+}
+
+uint16_t latency_percentile(uint8_t stage, uint8_t percent)
+{
+    if (!count[stage]) return 0;
+    uint32_t target = ((uint32_t)count[stage] * percent + 99) / 100;
+    if (!target) target = 1;
+    uint32_t sum = 0;
+    uint8_t b = 0;
+    for (; b < LATENCY_BUCKETS - 1; b++) {
+        if (sum + histogram[stage][b] >= target) break;
+        sum += histogram[stage][b];
+    }
+    /* samples are taken as evenly spread in bucket */
+    uint32_t us = (uint32_t)b * BUCKET_US(stage);
+    if (histogram[stage][b]) {
+        us += (uint32_t)BUCKET_US(stage) * (target - sum) / histogram[stage][b];
+    }
+    if (us < min[stage]) us = min[stage];
+    if (us > max[stage]) us = max[stage];
+    return us;
+}
+
+static void print_stage(uint8_t stage)
+{
+    switch (stage) {
+        case LATENCY_SCAN:              print("scan");      break;
+        case LATENCY_DEBOUNCE:          print("debounce");  break;
+        case LATENCY_ACTION_EXEC:       print("exec");      break;
+        case LATENCY_PROCESS_ACTION:    print("process");   break;
+        case LATENCY_HOST_SEND:         print("send");      break;
+        case LATENCY_ENDPOINT:          print("endpoint");  break;
+    }
+}
+
+void latency_print(void)
+{
+    latency_task();
+    print("\n----- Latency(us) -----\n");
+    print("bucket: "); print_dec(LATENCY_BUCKET_US);
+    print(" scan bucket: "); print_dec(LATENCY_SCAN_BUCKET_US);
+    print(" dropped: "); print_dec(trace_dropped); print("\n");
+    for (uint8_t s = 0; s < LATENCY_STAGES; s++) {
+        if (!count[s]) continue;
+        print_stage(s);
+        print(": n: "); print_dec(count[s]);
+        print(" p50: "); print_dec(latency_percentile(s, 50));
+        print(" p99: "); print_dec(latency_percentile(s, 99));
+        print(" min: "); print_dec(min[s]);
+        print(" max: "); print_dec(max[s]); print("\n");
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            if (!histogram[s][b]) continue;
+            print("  <"); print_dec((b + 1) * BUCKET_US(s));
+            if (b == LATENCY_BUCKETS - 1) print("+");
+            print("\t"); print_dec(histogram[s][b]); print("\n");
+        }
+    }
+}
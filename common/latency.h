@@ -0,0 +1,101 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+
+/*
+ * Latency trace
+ *
+ * LATENCY_MARK(stage) puts a timestamp(us) of the stage into a RAM ring and
+ * latency_task() folds the ring into histograms later in main loop. Key event
+ * starts at LATENCY_RAW, the scan where debounce first sees raw change of the
+ * key, so that debounce delay is included. Without it(no debounce module) it
+ * starts at the scan where change is first seen. Later stages are measured
+ * from start of that scan. LATENCY_SCAN is duration of matrix scan and has
+ * its own finer bucket.
+ *
+ * Marks compile to nothing unless LATENCY_TRACE is defined.
+ */
+enum latency_stage {
+    LATENCY_SCAN_START = 0,
+    LATENCY_SCAN_END,
+    LATENCY_RAW,
+    LATENCY_DEBOUNCE,
+    LATENCY_ACTION_EXEC,
+    LATENCY_PROCESS_ACTION,
+    LATENCY_HOST_SEND,
+    LATENCY_ENDPOINT,
+    LATENCY_STAGES,
+};
+/* histogram of scan duration is kept in slot of LATENCY_SCAN_START */
+#define LATENCY_SCAN    LATENCY_SCAN_START
+
+/* marks in ring before latency_task() */
+#ifndef LATENCY_TRACE_SIZE
+#define LATENCY_TRACE_SIZE  32
+#endif
+/* histogram bucket width(us) and number of buckets, last one counts overflow */
+#ifndef LATENCY_BUCKET_US
+#define LATENCY_BUCKET_US   500
+#endif
+#ifndef LATENCY_BUCKETS
+#define LATENCY_BUCKETS     32
+#endif
+#ifndef LATENCY_SCAN_BUCKET_US
+#define LATENCY_SCAN_BUCKET_US  50
+#endif
+#if (LATENCY_BUCKET_US * LATENCY_BUCKETS > 65535)
+#   error "LATENCY_BUCKET_US * LATENCY_BUCKETS must fit in 16 bits"
+#endif
+
+
+#ifdef LATENCY_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void latency_mark(uint8_t stage);
+void latency_task(void);
+void latency_clear(void);
+/* number of samples of the stage */
+uint16_t latency_samples(uint8_t stage);
+/* latency(us) under which percent of samples of the stage fall, interpolated
+ * in bucket and limited to min and max of samples */
+uint16_t latency_percentile(uint8_t stage, uint8_t percent);
+/* print histograms on console */
+void latency_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define LATENCY_MARK(stage)     latency_mark(stage)
+
+#else
+
+#define LATENCY_MARK(stage)
+#define latency_task()
+#define latency_clear()
+#define latency_print()
+
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+#include "timer.h"
+#include "debug.h"
+#include "matrix_event.h"
+
+
+static keyevent_t queue[MATRIX_EVENT_QUEUE_SIZE];
+static uint8_t head = 0;
+static uint8_t tail = 0;
+static bool overflow = false;
+
+
+bool matrix_event_put(keyevent_t event)
+{
+    uint8_t next = (head + 1) % MATRIX_EVENT_QUEUE_SIZE;
+    if (overflow || next == tail) {
+        overflow = true;
+        dprintf("matrix_event_put: overflow: %02X%02X\n", event.key.row, event.key.col);
+        return false;
+    }
+    if (event.time == 0) {
+        event.time = (timer_read() | 1); /* time should not be 0 */
+    }
+    queue[head] = event;
+    head = next;
+    return true;
+}
+
+bool matrix_event_get(keyevent_t *event)
+{
+    if (tail == head) return false;
+    *event = queue[tail];
+    tail = (tail + 1) % MATRIX_EVENT_QUEUE_SIZE;
+    return true;
+}
+
+void matrix_event_clear(void)
+{
+    head = tail = 0;
+    overflow = false;
+}
+
+bool matrix_event_overflowed(void)
+{
+    if (!overflow || tail != head) return false;
+    overflow = false;
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MATRIX_EVENT_H
+#define MATRIX_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+
+
+/*
+ * Matrix event queue
+ *
+ * Matrix drivers which know key changes by themselves(converters receiving
+ * make/break codes) can put events here in matrix_scan() instead of having
+ * keyboard_task() diff the whole matrix bitmap. Event with time 0 is stamped
+ * when it is queued.
+ *
+ * When the queue is full matrix_event_put() returns false and refuses events
+ * until the queue is drained. keyboard_task() then recovers lost events by
+ * diffing matrix with key state it has processed, so matrix driver must
+ * update its matrix even if the event is not queued. Queue holds
+ * MATRIX_EVENT_QUEUE_SIZE - 1 events; size it for changes of one scan.
+ */
+#ifndef MATRIX_EVENT_QUEUE_SIZE
+#define MATRIX_EVENT_QUEUE_SIZE 16
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool matrix_event_put(keyevent_t event);
+bool matrix_event_get(keyevent_t *event);
+void matrix_event_clear(void);
+/* true once after events were lost in overflow */
+bool matrix_event_overflowed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
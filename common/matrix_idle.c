@@ -0,0 +1,81 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "timer.h"
+#include "print.h"
+#include "matrix_idle.h"
+
+
+static volatile bool idle = false;
+static uint16_t active_time = 0;
+
+/* counts since last print */
+static uint16_t full_scans = 0;
+static uint16_t idle_reads = 0;
+
+
+bool matrix_idle(void)
+{
+    if (idle) idle_reads++;
+    return idle;
+}
+
+void matrix_idle_wake(void)
+{
+    idle = false;
+}
+
+bool matrix_idle_update(bool active)
+{
+    full_scans++;
+    if (active || idle) {
+        if (active) active_time = timer_read();
+        return false;
+    }
+    if (timer_elapsed(active_time) < MATRIX_IDLE_TIMEOUT) return false;
+
+    idle = true;
+    return true;
+}
+
+void matrix_idle_sleep(void)
+{
+#ifdef MATRIX_IDLE_SLEEP
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (idle) {
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+#endif
+}
+
+void matrix_idle_print(void)
+{
+    print("matrix idle: "); print_dec(idle);
+    print(" full_scans: "); print_dec(full_scans);
+    print(" idle_reads: "); print_dec(idle_reads);
+    print("\n");
+    full_scans = 0;
+    idle_reads = 0;
+}
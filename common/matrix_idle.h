@@ -0,0 +1,81 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MATRIX_IDLE_H
+#define MATRIX_IDLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Idle scan for row/column matrix drivers
+ *
+ * After no key is down or bouncing for MATRIX_IDLE_TIMEOUT(ms) matrix driver
+ * selects all its drive lines at once and only reads sense lines in
+ * matrix_scan(); any key pressed pulls its sense line. Driver goes back to
+ * full scan when the read finds activity or pin change interrupt calls
+ * matrix_idle_wake().
+ *
+ *      uint8_t matrix_scan(void)
+ *      {
+ *          if (matrix_idle()) {
+ *              if (!read_sense_lines()) {
+ *                  matrix_idle_sleep();
+ *                  return 1;
+ *              }
+ *              unselect_all();
+ *              matrix_idle_wake();
+ *          }
+ *          ...full scan and debounce...
+ *          if (matrix_idle_update(keys_down || debounce_active())) {
+ *              select_all();
+ *          }
+ *          return 1;
+ *      }
+ *
+ * With MATRIX_IDLE_SLEEP the MCU sleeps in idle mode until next interrupt,
+ * 1ms timer tick at latest, when idle read finds nothing.
+ */
+#ifndef MATRIX_IDLE_TIMEOUT
+#   define MATRIX_IDLE_TIMEOUT  1000
+#endif
+
+
+#ifdef MATRIX_IDLE_ENABLE
+
+/* whether full scan is skipped now */
+bool matrix_idle(void);
+/* back to full scan, can be called from interrupt */
+void matrix_idle_wake(void);
+/* call after full scan. returns true when driver should enter idle now */
+bool matrix_idle_update(bool active);
+/* sleep until next interrupt if MATRIX_IDLE_SLEEP */
+void matrix_idle_sleep(void);
+/* print counts of full scans and idle reads */
+void matrix_idle_print(void);
+
+#else
+
+#define matrix_idle()           false
+#define matrix_idle_wake()
+#define matrix_idle_update(a)   ((void)(a), false)
+#define matrix_idle_sleep()
+#define matrix_idle_print()
+
+#endif
+
+#endif
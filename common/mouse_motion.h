@@ -0,0 +1,101 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MOUSE_MOTION_H
+#define MOUSE_MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "report.h"
+
+
+/*
+ * Mouse motion accumulator
+ *
+ * Motion is kept in fixed point with MOTION_FRAC_BITS fraction bits. Only
+ * integer part is moved into report and remainder is carried to next report,
+ * so scaled motion(scroll divisor, diagonal of mousekey) loses nothing and
+ * motion larger than report range is split over successive reports.
+ */
+#define MOTION_FRAC_BITS    8
+#define MOTION_ONE          ((int32_t)1<<MOTION_FRAC_BITS)
+/* counts to fixed point */
+#define MOTION(counts)      ((int32_t)(counts) * MOTION_ONE)
+/* limit of backlog in counts */
+#define MOTION_BACKLOG_MAX  4096
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t v;
+    int32_t h;
+} mouse_motion_t;
+
+
+static inline int32_t motion_limit(int32_t a)
+{
+    if (a >  MOTION(MOTION_BACKLOG_MAX)) return  MOTION(MOTION_BACKLOG_MAX);
+    if (a < -MOTION(MOTION_BACKLOG_MAX)) return -MOTION(MOTION_BACKLOG_MAX);
+    return a;
+}
+
+/* add motion in fixed point */
+static inline void motion_add(mouse_motion_t *m, int32_t x, int32_t y, int32_t v, int32_t h)
+{
+    m->x = motion_limit(m->x + x);
+    m->y = motion_limit(m->y + y);
+    m->v = motion_limit(m->v + v);
+    m->h = motion_limit(m->h + h);
+}
+
+/* take integer part toward zero up to max and leave the rest */
+static inline int16_t motion_take_axis(int32_t *a, int16_t max)
+{
+    int16_t n;
+    if (*a >= 0) {
+        n = (*a >= MOTION(max)) ? max : (int16_t)(*a >> MOTION_FRAC_BITS);
+    } else {
+        n = (*a <= -MOTION(max)) ? -max : -(int16_t)(-*a >> MOTION_FRAC_BITS);
+    }
+    *a -= MOTION(n);
+    return n;
+}
+
+/* move motion into report, returns true if report has any motion */
+static inline bool motion_take(mouse_motion_t *m, report_mouse_t *r)
+{
+    r->x = motion_take_axis(&m->x, MOUSE_XY_MAX);
+    r->y = motion_take_axis(&m->y, MOUSE_XY_MAX);
+    r->v = motion_take_axis(&m->v, MOUSE_WHEEL_MAX);
+    r->h = motion_take_axis(&m->h, MOUSE_WHEEL_MAX);
+    return r->x || r->y || r->v || r->h;
+}
+
+/* whether whole counts are left to be sent */
+static inline bool motion_pending(mouse_motion_t *m)
+{
+    return m->x >= MOTION_ONE || m->x <= -MOTION_ONE ||
+           m->y >= MOTION_ONE || m->y <= -MOTION_ONE ||
+           m->v >= MOTION_ONE || m->v <= -MOTION_ONE ||
+           m->h >= MOTION_ONE || m->h <= -MOTION_ONE;
+}
+
+static inline void motion_clear(mouse_motion_t *m)
+{
+    m->x = m->y = m->v = m->h = 0;
+}
+
+#endif
@@ -23,14 +23,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "mousekey.h"
+#include "mouse_motion.h"
 
 
 
 static report_mouse_t mouse_report = {};
 static uint8_t mousekey_repeat =  0;
 static uint8_t mousekey_accel = 0;
+/* fraction of diagonal move carried to next report */
+static mouse_motion_t diagonal = {};
 
-static void mousekey_debug(void);
+static void mousekey_debug(report_mouse_t *report);
 
 
 /*
@@ -112,12 +115,6 @@ void mousekey_task(void)
     if (mouse_report.y > 0) mouse_report.y = move_unit();
     if (mouse_report.y < 0) mouse_report.y = move_unit() * -1;
 
-    /* diagonal move [1/sqrt(2) = 0.7] */
-    if (mouse_report.x && mouse_report.y) {
-        mouse_report.x *= 0.7;
-        mouse_report.y *= 0.7;
-    }
-
     if (mouse_report.v > 0) mouse_report.v = wheel_unit();
     if (mouse_report.v < 0) mouse_report.v = wheel_unit() * -1;
     if (mouse_report.h > 0) mouse_report.h = wheel_unit();
@@ -171,8 +168,19 @@ void mousekey_off(uint8_t code)
 
 void mousekey_send(void)
 {
-    mousekey_debug();
-    host_mouse_send(&mouse_report);
+    report_mouse_t report = mouse_report;
+
+    /* diagonal move [1/sqrt(2) = 181/256] */
+    if (report.x && report.y) {
+        motion_add(&diagonal, MOTION(report.x) * 181 / 256, MOTION(report.y) * 181 / 256, 0, 0);
+        report.x = motion_take_axis(&diagonal.x, MOUSE_XY_MAX);
+        report.y = motion_take_axis(&diagonal.y, MOUSE_XY_MAX);
+    } else {
+        motion_clear(&diagonal);
+    }
+
+    mousekey_debug(&report);
+    host_mouse_send(&report);
     last_timer = timer_read();
 }
 
@@ -181,17 +189,18 @@ void mousekey_clear(void)
     mouse_report = (report_mouse_t){};
     mousekey_repeat = 0;
     mousekey_accel = 0;
+    motion_clear(&diagonal);
 }
 
-static void mousekey_debug(void)
+static void mousekey_debug(report_mouse_t *report)
 {
     if (!debug_mouse) return;
     print("mousekey [btn|x y v h](rep/acl): [");
-    phex(mouse_report.buttons); print("|");
-    print_decs(mouse_report.x); print(" ");
-    print_decs(mouse_report.y); print(" ");
-    print_decs(mouse_report.v); print(" ");
-    print_decs(mouse_report.h); print("](");
+    phex(report->buttons); print("|");
+    print_decs(report->x); print(" ");
+    print_decs(report->y); print(" ");
+    print_decs(report->v); print(" ");
+    print_decs(report->h); print("](");
     print_dec(mousekey_repeat); print("/");
     print_dec(mousekey_accel); print(")\n");
 }
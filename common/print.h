@@ -90,6 +90,7 @@ void print_crlf(void);
 /* decimal */
 #define print_dec(i)        xprintf("%u", i)
 #define print_decs(i)       xprintf("%d", i)
+#define print_dec32(i)      xprintf("%lu", i)
 
 /* hex */
 #define print_hex4(i)       xprintf("%X", i)
@@ -118,6 +119,7 @@ void print_crlf(void);
 #define print_P(s)
 #define print_dec(data)
 #define print_decs(data)
+#define print_dec32(data)
 #define print_hex4(data)
 #define print_hex8(data)
 #define print_hex16(data)
@@ -136,10 +136,23 @@ typedef struct {
 } __attribute__ ((packed)) report_keyboard_t;
 */
 
+/* mouse X/Y range, 16-bit X/Y is supported only by LUFA */
+#ifdef MOUSE_XY_16BIT
+#   if !defined(PROTOCOL_LUFA) && !defined(PROTOCOL_SIM)
+#       error "MOUSE_XY_16BIT is supported only on LUFA"
+#   endif
+typedef int16_t mouse_xy_t;
+#   define MOUSE_XY_MAX     32767
+#else
+typedef int8_t mouse_xy_t;
+#   define MOUSE_XY_MAX     127
+#endif
+#define MOUSE_WHEEL_MAX     127
+
 typedef struct {
     uint8_t buttons;
-    int8_t x;
-    int8_t y;
+    mouse_xy_t x;
+    mouse_xy_t y;
     int8_t v;
     int8_t h;
 } __attribute__ ((packed)) report_mouse_t;
@@ -0,0 +1,64 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "print.h"
+#include "startup_trace.h"
+
+
+static uint32_t stage_time[STARTUP_STAGES];
+static uint8_t reached = 0;
+
+
+void startup_mark(uint8_t stage)
+{
+    if (reached & (1<<stage)) return;
+    reached |= (1<<stage);
+    stage_time[stage] = timer_read_us();
+}
+
+bool startup_reached(uint8_t stage)
+{
+    return reached & (1<<stage);
+}
+
+uint32_t startup_time(uint8_t stage)
+{
+    return stage_time[stage];
+}
+
+static void print_stage(uint8_t stage)
+{
+    switch (stage) {
+        case STARTUP_MATRIX_INIT:   print("matrix_init");   break;
+        case STARTUP_MOUSE_INIT:    print("mouse_init");    break;
+        case STARTUP_BOOTMAGIC:     print("bootmagic");     break;
+        case STARTUP_FIRST_SCAN:    print("first_scan");    break;
+        case STARTUP_FIRST_REPORT:  print("first_report");  break;
+    }
+}
+
+void startup_print(void)
+{
+    print("\n----- Startup(us) -----\n");
+    for (uint8_t s = 0; s < STARTUP_STAGES; s++) {
+        if (!startup_reached(s)) continue;
+        print_stage(s);
+        print(": "); print_dec32(stage_time[s]); print("\n");
+    }
+}
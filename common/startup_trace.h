@@ -0,0 +1,68 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Startup timeline
+ *
+ * STARTUP_MARK(stage) records time(us) when the stage is reached first time
+ * since keyboard_init(). Time before that(USB enumeration) is not counted
+ * because timer starts in keyboard_init(). Magic key `s` prints the timeline.
+ *
+ * Marks compile to nothing unless STARTUP_TRACE is defined.
+ */
+enum startup_stage {
+    STARTUP_MATRIX_INIT = 0,
+    STARTUP_MOUSE_INIT,
+    STARTUP_BOOTMAGIC,
+    STARTUP_FIRST_SCAN,
+    STARTUP_FIRST_REPORT,
+    STARTUP_STAGES,
+};
+
+
+#ifdef STARTUP_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void startup_mark(uint8_t stage);
+bool startup_reached(uint8_t stage);
+/* time(us) of the stage since keyboard_init() */
+uint32_t startup_time(uint8_t stage);
+void startup_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define STARTUP_MARK(stage)     startup_mark(stage)
+
+#else
+
+#define STARTUP_MARK(stage)
+#define startup_print()
+
+#endif
+
+#endif
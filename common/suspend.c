@@ -2,10 +2,12 @@
 #include "matrix.h"
 #include "action.h"
 #include "backlight.h"
+#include "eeconfig.h"
 
 
 void suspend_power_down(void)
 {
+    eeconfig_flush();
 #ifdef BACKLIGHT_ENABLE
     backlight_set(0);
 #endif
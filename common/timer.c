@@ -133,6 +133,26 @@ uint32_t timer_elapsed32(uint32_t last)
     return TIMER_DIFF_32(t, last);
 }
 
+uint32_t timer_read_us(void)
+{
+    uint32_t t;
+    uint8_t raw;
+
+    uint8_t sreg = SREG;
+    cli();
+    t = timer_count;
+    raw = TIMER_RAW;
+    // compare match which is not serviced yet
+#if !defined(__AVR_ATmega32__)
+    if ((TIFR0 & (1<<OCF0A)) && raw < TIMER_RAW_TOP) t++;
+#else
+    if ((TIFR & (1<<OCF0)) && raw < TIMER_RAW_TOP) t++;
+#endif
+    SREG = sreg;
+
+    return t * 1000 + (uint32_t)raw * 1000 / (TIMER_RAW_TOP + 1);
+}
+
 // excecuted once per 1ms.(excess for just timer count?)
 #if !defined(__AVR_ATmega32__)
 ISR(TIMER0_COMPA_vect)
@@ -59,6 +59,8 @@ uint16_t timer_read(void);
 uint32_t timer_read32(void);
 uint16_t timer_elapsed(uint16_t last);
 uint32_t timer_elapsed32(uint32_t last);
+/* time in microseconds with resolution of Timer0 tick */
+uint32_t timer_read_us(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,101 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "trace.h"
+
+
+typedef struct {
+    uint8_t  id;
+    uint8_t  seq;
+    uint32_t time;
+    uint16_t a;
+    uint32_t b;
+} trace_record_t;
+
+/* head is written only by producer and tail only by consumer */
+static trace_record_t ring[TRACE_SIZE];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+static uint8_t seq = 0;
+static uint16_t dropped = 0;
+
+/* compiler barrier: record is accessed only while its slot is owned, volatile
+ * index alone doesn't keep non-volatile record access on its side */
+#define BARRIER()   __asm__ __volatile__ ("" ::: "memory")
+
+
+static bool put(uint8_t id, uint16_t a, uint32_t b)
+{
+    uint8_t h = head;
+    uint8_t next = (h + 1) & (TRACE_SIZE - 1);
+    if (next == tail) return false;
+
+    trace_record_t *r = &ring[h];
+    r->id = id;
+    r->seq = seq++;
+    r->time = timer_read_us();
+    r->a = a;
+    r->b = b;
+    BARRIER();
+    head = next;
+    return true;
+}
+
+void trace_put(uint8_t id, uint16_t a, uint32_t b)
+{
+    if (dropped) {
+        if (!put(TRACE_DROPPED, dropped, 0)) {
+            if (dropped < UINT16_MAX) dropped++;
+            return;
+        }
+        dropped = 0;
+    }
+    if (!put(id, a, b)) {
+        dropped = 1;
+    }
+}
+
+static uint8_t *hex(uint8_t *p, uint32_t v, uint8_t digits)
+{
+    while (digits--) {
+        uint8_t n = (v >> (digits * 4)) & 0xF;
+        *p++ = n < 10 ? '0' + n : 'A' - 10 + n;
+    }
+    return p;
+}
+
+bool trace_get_line(uint8_t line[TRACE_LINE_SIZE])
+{
+    uint8_t t = tail;
+    if (t == head) return false;
+    BARRIER();
+
+    trace_record_t *r = &ring[t];
+    uint8_t *p = line;
+    *p++ = '~';
+    p = hex(p, r->id, 2);
+    p = hex(p, r->seq, 2);
+    p = hex(p, r->time, 8);
+    p = hex(p, r->a, 4);
+    p = hex(p, r->b, 8);
+    *p = '\n';
+    BARRIER();
+    tail = (t + 1) & (TRACE_SIZE - 1);
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Binary debug trace
+ *
+ * TRACE(id, a, b) puts format id, time(us) and raw arguments into a RAM ring
+ * in constant time; nothing is formatted on keyboard. Console driver drains
+ * the ring later(LUFA: USB start of frame) as lines of hex:
+ *
+ *     ~IISSTTTTTTTTAAAABBBBBBBB
+ *
+ * II: format id, SS: sequence number, T: time, A: a(16-bit), B: b(32-bit).
+ * tool/trace_decode renders them with format strings of common/trace_format.h
+ * and passes other console lines through.
+ *
+ * TRACE() may be called from main loop only; ring is lock-free single
+ * producer/single consumer. Records are dropped when ring is full and
+ * TRACE_DROPPED with the count is put when space is available.
+ *
+ * TRACE() compiles to nothing unless DEBUG_TRACE is defined.
+ */
+#define TRACE_FORMAT(id, format)    id,
+enum trace_id {
+#include "trace_format.h"
+    TRACE_IDS
+};
+#undef TRACE_FORMAT
+
+/* records in ring, power of 2 */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE  32
+#endif
+#if (TRACE_SIZE & (TRACE_SIZE - 1)) || TRACE_SIZE > 128
+#   error "TRACE_SIZE must be power of 2 and 128 at most"
+#endif
+
+/* length of a line including '~' and '\n' */
+#define TRACE_LINE_SIZE     26
+
+
+#ifdef DEBUG_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void trace_put(uint8_t id, uint16_t a, uint32_t b);
+/* encode oldest record into line, returns false when ring is empty */
+bool trace_get_line(uint8_t line[TRACE_LINE_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRACE(id, a, b)     trace_put(id, a, b)
+
+#else
+
+#define TRACE(id, a, b)
+
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Trace formats: TRACE_FORMAT(id, format)
+ *
+ * Shared by firmware(common/trace.h) and host decoder(tool/trace_decode.c).
+ * Format takes 16-bit a first and then 32-bit b with 'l' modifier, like
+ * "%u %08lX". Add new one at the end to keep ids of logs already recorded.
+ */
+TRACE_FORMAT(TRACE_DROPPED,         "dropped: %u records")
+TRACE_FORMAT(TRACE_MATRIX,          "matrix: row %u %08lX")
+TRACE_FORMAT(TRACE_ACTION_EXEC,     "action_exec: key %04X pressed %lu")
+TRACE_FORMAT(TRACE_PROCESS_ACTION,  "process_action: action %04X layer_state %08lX")
+TRACE_FORMAT(TRACE_KEYBOARD_REPORT, "keyboard_report: mods %02X keys %08lX")
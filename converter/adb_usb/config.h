@@ -51,6 +51,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define ADB_DATA_BIT    0
 //#define ADB_PSW_BIT     1       // optional
 
+/* ADB poll interval(ms) while keys are active and when idle.
+ * Set ADB_POLL_ACTIVE to 12 if a poor keyboard controller misses strokes. */
+#define ADB_POLL_ACTIVE         8
+#define ADB_POLL_IDLE           12
+/* keep active interval for this time(ms) after last data */
+#define ADB_POLL_ACTIVE_TIME    1000
+/* wait for keyboard to boot up(ms) before first command */
+#define ADB_INIT_WAIT           1000
+/* bootmagic sees keys only after keyboard boots up and is polled */
+#define BOOTMAGIC_SETTLE_SCANS  1200
+#define BOOTMAGIC_SETTLE_TIMEOUT    2000
+/* poll ADB mouse(address 3) on the same bus, requires MOUSE_ENABLE */
+//#define ADB_MOUSE_ENABLE
+
 /* key combination for command */
 #ifndef __ASSEMBLER__
 #include "adb.h"
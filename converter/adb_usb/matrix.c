@@ -25,8 +25,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "util.h"
 #include "debug.h"
+#include "timer.h"
 #include "adb.h"
 #include "matrix.h"
+#ifdef ADB_MOUSE_ENABLE
+#include "host.h"
+#endif
+#ifdef MATRIX_EVENT_QUEUE
+#include "matrix_event.h"
+#endif
 
 
 #if (MATRIX_COLS > 16)
@@ -35,10 +42,48 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #if (MATRIX_ROWS > 255)
 #   error "MATRIX_ROWS must not exceed 255"
 #endif
+#if defined(ADB_MOUSE_ENABLE) && !defined(MOUSE_ENABLE)
+#   error "ADB_MOUSE_ENABLE requires MOUSE_ENABLE"
+#endif
+
+#ifndef ADB_POLL_ACTIVE
+#   define ADB_POLL_ACTIVE      8
+#endif
+#ifndef ADB_POLL_IDLE
+#   define ADB_POLL_IDLE        12
+#endif
+#ifndef ADB_POLL_ACTIVE_TIME
+#   define ADB_POLL_ACTIVE_TIME 1000
+#endif
+#ifndef ADB_INIT_WAIT
+#   define ADB_INIT_WAIT        1000
+#endif
 
 
 static bool is_modified = false;
 
+/*
+ * ADB poll scheduler
+ *
+ * Talk command is issued only when poll interval of the device has passed
+ * and matrix_scan() returns immediately otherwise, instead of waiting 12ms
+ * before every poll. A device is polled every ADB_POLL_ACTIVE ms while it
+ * sends data and for ADB_POLL_ACTIVE_TIME ms after that, then every
+ * ADB_POLL_IDLE ms. One transaction is done per scan and keyboard goes first.
+ */
+typedef struct {
+    uint16_t last_poll;
+    uint16_t last_data;
+} adb_poll_t;
+
+static bool adb_ready = false;
+static uint16_t init_time = 0;
+static adb_poll_t kbd_poll = {};
+#ifdef ADB_MOUSE_ENABLE
+static adb_poll_t mouse_poll = {};
+static void mouse_poll_task(void);
+#endif
+
 // matrix state buffer(1:on, 0:off)
 #if (MATRIX_COLS <= 8)
 static uint8_t matrix[MATRIX_ROWS];
@@ -52,6 +97,14 @@ static bool matrix_has_ghost_in_row(uint8_t row);
 static void register_key(uint8_t key);
 
 
+static bool poll_due(adb_poll_t *poll)
+{
+    uint16_t interval = (timer_elapsed(poll->last_data) < ADB_POLL_ACTIVE_TIME) ?
+                        ADB_POLL_ACTIVE : ADB_POLL_IDLE;
+    return timer_elapsed(poll->last_poll) >= interval;
+}
+
+
 inline
 uint8_t matrix_rows(void)
 {
@@ -67,13 +120,9 @@ uint8_t matrix_cols(void)
 void matrix_init(void)
 {
     adb_host_init();
-    // wait for keyboard to boot up and receive command
-    _delay_ms(1000);
-    // Enable keyboard left/right modifier distinction
-    // Addr:Keyboard(0010), Cmd:Listen(10), Register3(11)
-    // upper byte: reserved bits 0000, device address 0010
-    // lower byte: device handler 00000011
-    adb_host_listen(0x2B,0x02,0x03);
+    // keyboard is set up in matrix_scan() after it boots up
+    init_time = timer_read();
+    adb_ready = false;
 
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
@@ -105,8 +154,30 @@ uint8_t matrix_scan(void)
 
     if ( codes == 0xFFFF )
     {
-        _delay_ms(12);  // delay for preventing overload of poor ADB keyboard controller
+        if (!adb_ready) {
+            // wait for keyboard to boot up and receive command
+            if (timer_elapsed(init_time) < ADB_INIT_WAIT) return 0;
+
+            // Enable keyboard left/right modifier distinction
+            // Addr:Keyboard(0010), Cmd:Listen(10), Register3(11)
+            // upper byte: reserved bits 0000, device address 0010
+            // lower byte: device handler 00000011
+            adb_host_listen(0x2B,0x02,0x03);
+            adb_ready = true;
+            kbd_poll.last_poll = timer_read();
+            return 0;
+        }
+
+        // interval for preventing overload of poor ADB keyboard controller
+        if (!poll_due(&kbd_poll)) {
+#ifdef ADB_MOUSE_ENABLE
+            if (poll_due(&mouse_poll)) mouse_poll_task();
+#endif
+            return 0;
+        }
+        kbd_poll.last_poll = timer_read();
         codes = adb_host_kbd_recv();
+        if (codes) kbd_poll.last_data = kbd_poll.last_poll;
     }
     key0 = codes>>8;
     key1 = codes&0xFF;
@@ -220,12 +291,52 @@ static bool matrix_has_ghost_in_row(uint8_t row)
 }
 #endif
 
+#ifdef ADB_MOUSE_ENABLE
+/*
+ * ADB mouse register 0
+ * bit: 15      button(0:pressed)
+ *      14-8    Y movement(7-bit signed)
+ *      7       button 2 of some mice(0:pressed), otherwise always 1
+ *      6-0     X movement(7-bit signed)
+ */
+static void mouse_poll_task(void)
+{
+    mouse_poll.last_poll = timer_read();
+    uint16_t codes = adb_host_mouse_recv();
+    if (!codes) return;
+    mouse_poll.last_data = mouse_poll.last_poll;
+
+    uint8_t x = codes & 0x7F;
+    uint8_t y = (codes>>8) & 0x7F;
+    report_mouse_t mouse_report = {};
+    if (!(codes & 0x8000)) mouse_report.buttons |= MOUSE_BTN1;
+    if (!(codes & 0x0080)) mouse_report.buttons |= MOUSE_BTN2;
+    mouse_report.x = (x & 0x40) ? (int8_t)x - 0x80 : x;
+    mouse_report.y = (y & 0x40) ? (int8_t)y - 0x80 : y;
+
+    if (debug_mouse) {
+        print("adb_host_mouse_recv: "); phex16(codes); print("\n");
+    }
+    host_mouse_send(&mouse_report);
+}
+#endif
+
 inline
 static void register_key(uint8_t key)
 {
     uint8_t col, row;
     col = key&0x07;
     row = (key>>3)&0x0F;
+#ifdef MATRIX_EVENT_QUEUE
+    // ignore repeated make/break not to queue redundant events
+    bool pressed = !(key&0x80);
+    if (pressed != !!(matrix[row] & (1<<col))) {
+        matrix_event_put((keyevent_t){
+            .key = (key_t){ .row = row, .col = col },
+            .pressed = pressed
+        });
+    }
+#endif
     if (key&0x80) {
         matrix[row] &= ~(1<<col);
     } else {
@@ -43,6 +43,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#define NO_SUSPEND_POWER_DOWN
 
 
+/* keyboard reports keys held at power-up after its self test(500-750ms) */
+#define BOOTMAGIC_SETTLE_SCANS  1000
+
+
 /*
  * PS/2 Busywait
  */
@@ -80,6 +84,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS2_INT_OFF() do {      \
     EIMSK &= ~(1<<INT1);        \
 } while (0)
+#define PS2_INT_CLEAR() do {    \
+    EIFR = (1<<INTF1);          \
+} while (0)
 #define PS2_INT_VECT    INT1_vect
 #endif
 
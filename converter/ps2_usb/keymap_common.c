@@ -17,10 +17,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "keymap_common.h"
 
 
+/* PS/2 codes used in KEYMAP_ALL: bit n of byte m is code m*8+n */
+const uint8_t PROGMEM keymap_codes[MATRIX_ROWS] = {
+    0xFA, 0x7F, 0x7F, 0x7D, 0x7F, 0x7F, 0x7F, 0x7D,
+    0x7F, 0x7F, 0xB7, 0xAF, 0xD2, 0x1E, 0xFF, 0x7F,
+    0x08, 0x00, 0x33, 0x81, 0x8B, 0x89, 0x95, 0x8D,
+    0x01, 0x25, 0x01, 0x44, 0x00, 0x1A, 0x37, 0x74,
+};
+
+/* number of codes before byte m of keymap_codes */
+const uint8_t PROGMEM keymap_ranks[MATRIX_ROWS] = {
+      0,   6,  13,  20,  26,  33,  40,  47,
+     53,  60,  67,  73,  79,  83,  87,  95,
+    102, 103, 103, 107, 109, 113, 116, 120,
+    124, 125, 128, 129, 131, 131, 134, 139,
+};
+
 /* translates key to keycode */
 uint8_t keymap_key_to_keycode(uint8_t layer, key_t key)
 {
-    return pgm_read_byte(&keymaps[(layer)][(key.row)][(key.col)]);
+    return keymap_sparse_keycode(layer, key);
 }
 
 /* translates Fn keycode to action */
@@ -29,8 +29,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "keymap.h"
 
 
-// 32*8(256) byte array which converts PS/2 code into USB code
-extern const uint8_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+// PS/2 codes which have a key, out of 32*8(256)
+#define KEYMAP_CODES    143
+#include "keymap_sparse.h"
+
 extern const uint16_t fn_actions[];
 
 
@@ -53,38 +55,36 @@ extern const uint16_t fn_actions[];
     K90, KBA, KB8, KB0,      /* WWW Search, Home, Back, Forward */                          \
     KA8, KA0, K98            /* WWW Stop, Refresh, Favorites */                             \
 ) { \
-    { KC_NO,    KC_##K01, KC_NO,    KC_##K03, KC_##K04, KC_##K05, KC_##K06, KC_##K07 }, \
-    { KC_##K08, KC_##K09, KC_##K0A, KC_##K0B, KC_##K0C, KC_##K0D, KC_##K0E, KC_NO    }, \
-    { KC_##K10, KC_##K11, KC_##K12, KC_##K13, KC_##K14, KC_##K15, KC_##K16, KC_NO    }, \
-    { KC_##K18, KC_NO,    KC_##K1A, KC_##K1B, KC_##K1C, KC_##K1D, KC_##K1E, KC_NO    }, \
-    { KC_##K20, KC_##K21, KC_##K22, KC_##K23, KC_##K24, KC_##K25, KC_##K26, KC_NO    }, \
-    { KC_##K28, KC_##K29, KC_##K2A, KC_##K2B, KC_##K2C, KC_##K2D, KC_##K2E, KC_NO    }, \
-    { KC_##K30, KC_##K31, KC_##K32, KC_##K33, KC_##K34, KC_##K35, KC_##K36, KC_NO    }, \
-    { KC_##K38, KC_NO,    KC_##K3A, KC_##K3B, KC_##K3C, KC_##K3D, KC_##K3E, KC_NO    }, \
-    { KC_##K40, KC_##K41, KC_##K42, KC_##K43, KC_##K44, KC_##K45, KC_##K46, KC_NO    }, \
-    { KC_##K48, KC_##K49, KC_##K4A, KC_##K4B, KC_##K4C, KC_##K4D, KC_##K4E, KC_NO    }, \
-    { KC_##K50, KC_##K51, KC_##K52, KC_NO,    KC_##K54, KC_##K55, KC_NO,    KC_##K57 }, \
-    { KC_##K58, KC_##K59, KC_##K5A, KC_##K5B, KC_NO,    KC_##K5D, KC_NO,    KC_##K5F }, \
-    { KC_NO,    KC_##K61, KC_NO,    KC_NO,    KC_##K64, KC_NO,    KC_##K66, KC_##K67 }, \
-    { KC_NO,    KC_##K69, KC_##K6A, KC_##K6B, KC_##K6C, KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_##K70, KC_##K71, KC_##K72, KC_##K73, KC_##K74, KC_##K75, KC_##K76, KC_##K77 }, \
-    { KC_##K78, KC_##K79, KC_##K7A, KC_##K7B, KC_##K7C, KC_##K7D, KC_##K7E, KC_NO    }, \
-    { KC_NO,    KC_NO,    KC_NO,    KC_##K83, KC_NO,    KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_##K90, KC_##K91, KC_NO,    KC_NO,    KC_##K94, KC_##K95, KC_NO,    KC_NO    }, \
-    { KC_##K98, KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_##K9F }, \
-    { KC_##KA0, KC_##KA1, KC_NO,    KC_##KA3, KC_NO,    KC_NO,    KC_NO,    KC_##KA7 }, \
-    { KC_##KA8, KC_NO,    KC_NO,    KC_##KAB, KC_NO,    KC_NO,    KC_NO,    KC_##KAF }, \
-    { KC_##KB0, KC_NO,    KC_##KB2, KC_NO,    KC_##KB4, KC_NO,    KC_NO,    KC_##KB7 }, \
-    { KC_##KB8, KC_NO,    KC_##KBA, KC_##KBB, KC_NO,    KC_NO,    KC_NO,    KC_##KBF }, \
-    { KC_##KC0, KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_##KC8, KC_NO,    KC_##KCA, KC_NO,    KC_NO,    KC_##KCD, KC_NO,    KC_NO    }, \
-    { KC_##KD0, KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_NO,    KC_NO,    KC_##KDA, KC_NO,    KC_NO,    KC_NO,    KC_##KDE, KC_NO    }, \
-    { KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_NO,    KC_##KE9, KC_NO,    KC_##KEB, KC_##KEC, KC_NO,    KC_NO,    KC_NO    }, \
-    { KC_##KF0, KC_##KF1, KC_##KF2, KC_NO,    KC_##KF4, KC_##KF5, KC_NO,    KC_NO    }, \
-    { KC_NO,    KC_NO,    KC_##KFA, KC_NO,    KC_##KFC, KC_##KFD, KC_##KFE, KC_NO    }, \
+    KC_##K01, KC_##K03, KC_##K04, KC_##K05, KC_##K06, KC_##K07,                     /* 00-07 */ \
+    KC_##K08, KC_##K09, KC_##K0A, KC_##K0B, KC_##K0C, KC_##K0D, KC_##K0E,           /* 08-0F */ \
+    KC_##K10, KC_##K11, KC_##K12, KC_##K13, KC_##K14, KC_##K15, KC_##K16,           /* 10-17 */ \
+    KC_##K18, KC_##K1A, KC_##K1B, KC_##K1C, KC_##K1D, KC_##K1E,                     /* 18-1F */ \
+    KC_##K20, KC_##K21, KC_##K22, KC_##K23, KC_##K24, KC_##K25, KC_##K26,           /* 20-27 */ \
+    KC_##K28, KC_##K29, KC_##K2A, KC_##K2B, KC_##K2C, KC_##K2D, KC_##K2E,           /* 28-2F */ \
+    KC_##K30, KC_##K31, KC_##K32, KC_##K33, KC_##K34, KC_##K35, KC_##K36,           /* 30-37 */ \
+    KC_##K38, KC_##K3A, KC_##K3B, KC_##K3C, KC_##K3D, KC_##K3E,                     /* 38-3F */ \
+    KC_##K40, KC_##K41, KC_##K42, KC_##K43, KC_##K44, KC_##K45, KC_##K46,           /* 40-47 */ \
+    KC_##K48, KC_##K49, KC_##K4A, KC_##K4B, KC_##K4C, KC_##K4D, KC_##K4E,           /* 48-4F */ \
+    KC_##K50, KC_##K51, KC_##K52, KC_##K54, KC_##K55, KC_##K57,                     /* 50-57 */ \
+    KC_##K58, KC_##K59, KC_##K5A, KC_##K5B, KC_##K5D, KC_##K5F,                     /* 58-5F */ \
+    KC_##K61, KC_##K64, KC_##K66, KC_##K67,                                         /* 60-67 */ \
+    KC_##K69, KC_##K6A, KC_##K6B, KC_##K6C,                                         /* 68-6F */ \
+    KC_##K70, KC_##K71, KC_##K72, KC_##K73, KC_##K74, KC_##K75, KC_##K76, KC_##K77, /* 70-77 */ \
+    KC_##K78, KC_##K79, KC_##K7A, KC_##K7B, KC_##K7C, KC_##K7D, KC_##K7E,           /* 78-7F */ \
+    KC_##K83,                                                                       /* 80-87 */ \
+    KC_##K90, KC_##K91, KC_##K94, KC_##K95,                                         /* 90-97 */ \
+    KC_##K98, KC_##K9F,                                                             /* 98-9F */ \
+    KC_##KA0, KC_##KA1, KC_##KA3, KC_##KA7,                                         /* A0-A7 */ \
+    KC_##KA8, KC_##KAB, KC_##KAF,                                                   /* A8-AF */ \
+    KC_##KB0, KC_##KB2, KC_##KB4, KC_##KB7,                                         /* B0-B7 */ \
+    KC_##KB8, KC_##KBA, KC_##KBB, KC_##KBF,                                         /* B8-BF */ \
+    KC_##KC0,                                                                       /* C0-C7 */ \
+    KC_##KC8, KC_##KCA, KC_##KCD,                                                   /* C8-CF */ \
+    KC_##KD0,                                                                       /* D0-D7 */ \
+    KC_##KDA, KC_##KDE,                                                             /* D8-DF */ \
+    KC_##KE9, KC_##KEB, KC_##KEC,                                                   /* E8-EF */ \
+    KC_##KF0, KC_##KF1, KC_##KF2, KC_##KF4, KC_##KF5,                               /* F0-F7 */ \
+    KC_##KFA, KC_##KFC, KC_##KFD, KC_##KFE                                          /* F8-FF */ \
 }
 
 /* US layout */
@@ -3,7 +3,7 @@
  */
 #include "keymap_common.h"
 
-const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+const uint8_t PROGMEM keymaps[][KEYMAP_CODES] = {
     /* 0: JIS LAYOUT
      * ,---.   ,---------------. ,---------------. ,---------------. ,-----------.     ,-----------.
      * |Esc|   |F1 |F2 |F3 |F4 | |F5 |F6 |F7 |F8 | |F9 |F10|F11|F12| |PrS|ScL|Pau|     |Pwr|Slp|Wak|
@@ -30,5 +30,10 @@ const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     ),
 };
 
+const keymap_overlay_t PROGMEM keymap_overlays[] = {
+};
+
+KEYMAP_SPARSE_SIZE;
+
 const uint16_t PROGMEM fn_actions[] = {
 };
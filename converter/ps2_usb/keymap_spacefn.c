@@ -5,7 +5,7 @@
 #include "keymap_common.h"
 
 
-const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
+const uint8_t PROGMEM keymaps[][KEYMAP_CODES] = {
     /* 0: default
      * ,---.   ,---------------. ,---------------. ,---------------. ,-----------.     ,-----------.
      * |Esc|   |F1 |F2 |F3 |F4 | |F5 |F6 |F7 |F8 | |F9 |F10|F11|F12| |PrS|ScL|Pau|     |Pwr|Slp|Wak|
@@ -30,7 +30,9 @@ const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
     LSFT,Z,   X,   C,   V,   B,   N,   M,   COMM,DOT, SLSH,          RSFT,          UP,           P1,  P2,  P3,
     LCTL,LGUI,LALT,          FN0,                     RALT,RGUI,APP, RCTL,     LEFT,DOWN,RGHT,    P0,       PDOT,PENT
     ),
+};
 
+const keymap_overlay_t PROGMEM keymap_overlays[] = {
     /* 1: SpaceFN
      * ,-----------------------------------------------------------.
      * |`  | F1| F2| F3| F4| F5| F6| F7| F8| F9|F10|F11|F12|Delete |
@@ -44,16 +46,41 @@ const uint8_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
      * |    |    |    |                        |    |    |    |    |
      * `-----------------------------------------------------------'
      */
-    KEYMAP(
-    ESC, F1,  F2,  F3,  F4,  F5,  F6,  F7,  F8,  F9,  F10, F11, F12,           PSCR,SLCK,BRK,
-    GRV, F1,  F2,  F3,  F4,  F5,  F6,  F7,  F8,  F9,  F10, F11, F12, DEL,      INS, HOME,PGUP,    NLCK,PSLS,PAST,PMNS,
-    TRNS,TRNS,TRNS,ESC, TRNS,TRNS,TRNS,HOME,UP,  END, PSCR,SLCK,PAUS,INS,      DEL, END, PGDN,    P7,  P8,  P9,
-    TRNS,TRNS,TRNS,TRNS,TRNS,TRNS,PGUP,LEFT,DOWN,RGHT,TRNS,TRNS,     TRNS,                        P4,  P5,  P6,  PPLS,
-    TRNS,TRNS,TRNS,TRNS,TRNS,SPC, PGDN,GRV, FN1, TRNS,APP,           TRNS,          UP,           P1,  P2,  P3,
-    TRNS,TRNS,TRNS,          TRNS,                    TRNS,TRNS,TRNS,TRNS,     LEFT,DOWN,RGHT,    P0,       PDOT,PENT
-    ),
+    KEYMAP_OVERLAY(1, 0x0E, GRV),  /* ` */
+    KEYMAP_OVERLAY(1, 0x16, F1),   /* 1 */
+    KEYMAP_OVERLAY(1, 0x1E, F2),   /* 2 */
+    KEYMAP_OVERLAY(1, 0x24, ESC),  /* E */
+    KEYMAP_OVERLAY(1, 0x25, F4),   /* 4 */
+    KEYMAP_OVERLAY(1, 0x26, F3),   /* 3 */
+    KEYMAP_OVERLAY(1, 0x2E, F5),   /* 5 */
+    KEYMAP_OVERLAY(1, 0x31, PGDN), /* N */
+    KEYMAP_OVERLAY(1, 0x32, SPC),  /* B */
+    KEYMAP_OVERLAY(1, 0x33, PGUP), /* H */
+    KEYMAP_OVERLAY(1, 0x36, F6),   /* 6 */
+    KEYMAP_OVERLAY(1, 0x3A, GRV),  /* M */
+    KEYMAP_OVERLAY(1, 0x3B, LEFT), /* J */
+    KEYMAP_OVERLAY(1, 0x3C, HOME), /* U */
+    KEYMAP_OVERLAY(1, 0x3D, F7),   /* 7 */
+    KEYMAP_OVERLAY(1, 0x3E, F8),   /* 8 */
+    KEYMAP_OVERLAY(1, 0x41, FN1),  /* , */
+    KEYMAP_OVERLAY(1, 0x42, DOWN), /* K */
+    KEYMAP_OVERLAY(1, 0x43, UP),   /* I */
+    KEYMAP_OVERLAY(1, 0x44, END),  /* O */
+    KEYMAP_OVERLAY(1, 0x45, F10),  /* 0 */
+    KEYMAP_OVERLAY(1, 0x46, F9),   /* 9 */
+    KEYMAP_OVERLAY(1, 0x4A, APP),  /* / */
+    KEYMAP_OVERLAY(1, 0x4B, RGHT), /* L */
+    KEYMAP_OVERLAY(1, 0x4D, PSCR), /* P */
+    KEYMAP_OVERLAY(1, 0x4E, F11),  /* - */
+    KEYMAP_OVERLAY(1, 0x54, SLCK), /* [ */
+    KEYMAP_OVERLAY(1, 0x55, F12),  /* = */
+    KEYMAP_OVERLAY(1, 0x5B, PAUS), /* ] */
+    KEYMAP_OVERLAY(1, 0x5D, INS),  /* \ */
+    KEYMAP_OVERLAY(1, 0x66, DEL),  /* Backspace */
 };
 
+KEYMAP_SPARSE_SIZE;
+
 const uint16_t PROGMEM fn_actions[] = {
     [0] = ACTION_LAYER_TAP_KEY(1, KC_SPACE),
     [1] = ACTION_MODS_KEY(MOD_LSFT, KC_GRV),    // tilde
@@ -25,6 +25,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "ps2.h"
 #include "matrix.h"
+#ifdef MATRIX_EVENT_QUEUE
+#include "matrix_event.h"
+#endif
 
 
 static void matrix_make(uint8_t code);
@@ -468,6 +471,12 @@ static void matrix_make(uint8_t code)
     if (!matrix_is_on(ROW(code), COL(code))) {
         matrix[ROW(code)] |= 1<<COL(code);
         is_modified = true;
+#ifdef MATRIX_EVENT_QUEUE
+        matrix_event_put((keyevent_t){
+            .key = (key_t){ .row = ROW(code), .col = COL(code) },
+            .pressed = true
+        });
+#endif
     }
 }
 
@@ -477,11 +486,25 @@ static void matrix_break(uint8_t code)
     if (matrix_is_on(ROW(code), COL(code))) {
         matrix[ROW(code)] &= ~(1<<COL(code));
         is_modified = true;
+#ifdef MATRIX_EVENT_QUEUE
+        matrix_event_put((keyevent_t){
+            .key = (key_t){ .row = ROW(code), .col = COL(code) },
+            .pressed = false
+        });
+#endif
     }
 }
 
 inline
 static void matrix_clear(void)
 {
+#ifdef MATRIX_EVENT_QUEUE
+    // release keys on through the queue, nobody diffs the matrix
+    for (uint8_t i=0; i < MATRIX_ROWS; i++) {
+        for (uint8_t j=0; j < MATRIX_COLS; j++) {
+            if (matrix[i] & (1<<j)) matrix_break(i<<3 | j);
+        }
+    }
+#endif
     for (uint8_t i=0; i < MATRIX_ROWS; i++) matrix[i] = 0x00;
 }
@@ -116,6 +116,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS2_INT_OFF() do {      \
     EIMSK &= ~(1<<INT1);        \
 } while (0)
+#define PS2_INT_CLEAR() do {    \
+    EIFR = (1<<INTF1);          \
+} while (0)
 #define PS2_INT_VECT    INT1_vect
 #endif
 
@@ -33,6 +33,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MATRIX_ROWS 32
 #define MATRIX_COLS 8
 
+/* a report changes 8 mods and 6 keys released and pressed at most */
+#define MATRIX_EVENT_QUEUE_SIZE 21
+
 #define USE_LEGACY_KEYMAP
 
 /* key combination for command */
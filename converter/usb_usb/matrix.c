@@ -23,6 +23,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "print.h"
 #include "debug.h"
 #include "matrix.h"
+#ifdef MATRIX_EVENT_QUEUE
+#include "matrix_event.h"
+#endif
 
 /* KEY CODE to Matrix
  *
@@ -56,12 +59,61 @@ bool matrix_has_ghost(void) { return false; }
 
 static bool matrix_is_mod =false;
 
+#ifdef MATRIX_EVENT_QUEUE
+static bool report_has_key(report_keyboard_t *report, uint8_t code)
+{
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
+    }
+    return false;
+}
+
+static void matrix_event_code(uint8_t code, bool pressed)
+{
+    matrix_event_put((keyevent_t){
+        .key = (key_t){ .row = ROW(code), .col = COL(code) },
+        .pressed = pressed
+    });
+}
+
+/* queue difference between last and current report as key events */
+static void matrix_event_report(void)
+{
+    static report_keyboard_t last_report;
+    report_keyboard_t *report = &usb_hid_keyboard_report;
+
+    uint8_t mods_change = last_report.mods ^ report->mods;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (mods_change & (1<<i)) {
+            matrix_event_code(KC_LCTRL + i, report->mods & (1<<i));
+        }
+    }
+    // breaks first so that rolled keys are released before next one
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        uint8_t code = last_report.keys[i];
+        if (IS_ANY(code) && !report_has_key(report, code)) {
+            matrix_event_code(code, false);
+        }
+    }
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        uint8_t code = report->keys[i];
+        if (IS_ANY(code) && !report_has_key(&last_report, code)) {
+            matrix_event_code(code, true);
+        }
+    }
+    last_report = *report;
+}
+#endif
+
 uint8_t matrix_scan(void) {
     static uint16_t last_time_stamp = 0;
 
     if (last_time_stamp != usb_hid_time_stamp) {
         last_time_stamp = usb_hid_time_stamp;
         matrix_is_mod = true;
+#ifdef MATRIX_EVENT_QUEUE
+        matrix_event_report();
+#endif
     } else {
         matrix_is_mod = false;
     }
@@ -26,13 +26,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_idle.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	5
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
@@ -41,6 +38,7 @@ static matrix_row_t read_cols(void);
 static void init_cols(void);
 static void unselect_rows(void);
 static void select_row(uint8_t row);
+static void select_all_rows(void);
 
 
 inline
@@ -66,40 +64,42 @@ void matrix_init(void)
         matrix[i] = 0;
         matrix_debouncing[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
+    if (matrix_idle()) {
+        // all rows are selected while idle, any key pulls its column low
+        if (!read_cols()) {
+            matrix_idle_sleep();
+            return 1;
+        }
+        unselect_rows();
+        _delay_us(30);
+        matrix_idle_wake();
+    }
+
+    bool active = false;
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
         select_row(i);
         _delay_us(30);  // without this wait read unstable value.
-        matrix_row_t cols = read_cols();
-        if (matrix_debouncing[i] != cols) {
-            matrix_debouncing[i] = cols;
-            if (debouncing) {
-                debug("bounce!: "); debug_hex(debouncing); debug("\n");
-            }
-            debouncing = DEBOUNCE;
-        }
+        matrix_debouncing[i] = read_cols();
+        if (matrix_debouncing[i]) active = true;
         unselect_rows();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
-    }
+    debounce(matrix_debouncing, matrix);
 
+    if (matrix_idle_update(active || debounce_active())) {
+        select_all_rows();
+    }
     return 1;
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -209,3 +209,9 @@ static void select_row(uint8_t row)
             break;
     }
 }
+
+static void select_all_rows(void)
+{
+    DDRD  |=  0b00101111;
+    PORTD &= ~0b00101111;
+}
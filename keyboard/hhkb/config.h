@@ -50,6 +50,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /* Boot Magic salt key: Space */
 #define BOOTMAGIC_KEY_SALT      KC_FN6
 
+/* matrix scan: see matrix.c */
+//#define HHKB_SETTLE_US          5
+//#define HHKB_SCAN_PIPELINE
+//#define HHKB_SETTLE_CALIBRATE
+/* calibrated wait is slowest of sampled presses plus margin(us). A key slower
+ * than that misses its press until next recheck scan, every HHKB_SETTLE_RECHECK
+ * full scans(~100ms), raises the wait. */
+//#define HHKB_SETTLE_MARGIN      2
+//#define HHKB_SETTLE_RECHECK     16
+//#define HHKB_FAST_SCAN_TIME     5
+
 
 /*
  * Feature disable options
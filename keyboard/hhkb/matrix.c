@@ -29,12 +29,71 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hhkb_avr.h"
 
 
+/*
+ * Scan options(config.h)
+ *
+ * HHKB_SETTLE_US       wait(us) from KEY_ENABLE to reading KEY_STATE
+ * HHKB_SCAN_PIPELINE   select next key while KEY_STATE of last key returns to
+ *                      idle, this saves 15us of each key
+ * HHKB_SETTLE_CALIBRATE
+ *                      measure how long KEY_STATE of pressed key takes to turn on
+ *                      on first HHKB_SETTLE_SAMPLES key presses after boot, one
+ *                      sample per press, and shorten the wait to that plus
+ *                      HHKB_SETTLE_MARGIN. Every HHKB_SETTLE_RECHECK full scans
+ *                      keys are read with full HHKB_SETTLE_US wait and measured
+ *                      again; the wait is raised when a key is slower than
+ *                      calibrated. Until then press of such key is missed.
+ * HHKB_FAST_SCAN_TIME  rescan only rows which have key on or just released for
+ *                      this period(ms) after each full scan. Press on other rows
+ *                      is detected on next full scan.
+ */
+#ifndef HHKB_SETTLE_US
+#   define HHKB_SETTLE_US       5
+#endif
+#ifndef HHKB_SETTLE_SAMPLES
+#   define HHKB_SETTLE_SAMPLES  32
+#endif
+#ifndef HHKB_SETTLE_MARGIN
+#   define HHKB_SETTLE_MARGIN   2
+#endif
+#ifndef HHKB_SETTLE_RECHECK
+#   define HHKB_SETTLE_RECHECK  16
+#endif
+
+
 // matrix state buffer(1:on, 0:off)
 static matrix_row_t *matrix;
 static matrix_row_t *matrix_prev;
 static matrix_row_t _matrix0[MATRIX_ROWS];
 static matrix_row_t _matrix1[MATRIX_ROWS];
 
+#define ALL_ROWS    ((uint16_t)((1UL<<MATRIX_ROWS) - 1))
+
+// wait(us) from KEY_ENABLE to reading KEY_STATE
+static uint8_t settle_us = HHKB_SETTLE_US;
+
+#ifdef HHKB_SETTLE_CALIBRATE
+// longest time(us) for KEY_STATE of newly pressed key to turn on, and number of presses sampled
+static uint8_t settle_max;
+static uint8_t settle_samples;
+// full scans until next scan with HHKB_SETTLE_US wait, and whether this is the one
+static uint8_t settle_recheck = HHKB_SETTLE_RECHECK;
+static bool settle_full;
+#endif
+
+#ifdef HHKB_FAST_SCAN_TIME
+// rows which had key on or changed in last scan, and time of last full scan
+static uint16_t active_rows;
+static uint16_t full_scan_time;
+#endif
+
+// scan timing: duration of last full and fast scan(us) and scans per second
+static uint16_t full_scan_us;
+static uint16_t fast_scan_us;
+static uint16_t scan_count;
+static uint16_t scan_rate;
+static uint16_t scan_rate_time;
+
 
 inline
 uint8_t matrix_rows(void)
@@ -64,6 +123,140 @@ void matrix_init(void)
     matrix_prev = _matrix1;
 }
 
+static inline void select_key(uint8_t row, uint8_t col)
+{
+    KEY_SELECT(row, col);
+    _delay_us(5);
+
+    // Not sure this is needed. This just emulates HHKB controller's behaviour.
+    if (matrix_prev[row] & (1<<col)) {
+        KEY_PREV_ON();
+    }
+    _delay_us(10);
+}
+
+static void read_key(uint8_t row, uint8_t col)
+{
+    // NOTE: KEY_STATE is valid only in 20us after KEY_ENABLE.
+    // If V-USB interrupts in this section we could lose 40us or so
+    // and would read invalid value from KEY_STATE.
+    uint8_t last = TIMER_RAW;
+
+    KEY_ENABLE();
+
+    // Wait for KEY_STATE outputs its value.
+    // 1us was ok on one HHKB, but not worked on another.
+    // no   wait doesn't work on Teensy++ with pro(1us works)
+    // no   wait does    work on tmk PCB(8MHz) with pro2
+    // 1us  wait does    work on both of above
+    // 1us  wait doesn't work on tmk(16MHz)
+    // 5us  wait does    work on tmk(16MHz)
+    // 5us  wait does    work on tmk(16MHz/2)
+    // 5us  wait does    work on tmk(8MHz)
+    // 10us wait does    work on Teensy++ with pro
+    // 10us wait does    work on 328p+iwrap with pro
+    // 10us wait doesn't work on tmk PCB(8MHz) with pro2(very lagged scan)
+#ifdef HHKB_SETTLE_CALIBRATE
+    uint8_t on_us = 0;
+    uint8_t wait_us = settle_full ? HHKB_SETTLE_US : settle_us;
+    for (uint8_t i = 1; i <= wait_us; i++) {
+        _delay_us(1);
+        if (!on_us && !KEY_STATE()) on_us = i;
+    }
+#else
+    for (uint8_t i = settle_us; i; i--) {
+        _delay_us(1);
+    }
+#endif
+    bool on = !KEY_STATE();
+
+    // Ignore if this code region execution time elapses more than 20us,
+    // the key keeps its previous state.
+    // MEMO: 20[us] * (TIMER_RAW_FREQ / 1000000)[count per us]
+    // MEMO: then change above using this rule: a/(b/c) = a*1/(b/c) = a*(c/b)
+    if (TIMER_DIFF_RAW(TIMER_RAW, last) <= 20/(1000000/TIMER_RAW_FREQ)) {
+        if (on) {
+            matrix[row] |= (1<<col);
+        } else {
+            matrix[row] &= ~(1<<col);
+        }
+#ifdef HHKB_SETTLE_CALIBRATE
+        // sample only new press; held key is read with KEY_PREV_ON hysteresis
+        // and would count one press many times
+        if (on && on_us && !(matrix_prev[row] & (1<<col)) &&
+                settle_samples < HHKB_SETTLE_SAMPLES) {
+            if (on_us > settle_max) settle_max = on_us;
+            if (++settle_samples == HHKB_SETTLE_SAMPLES) {
+                settle_us = settle_max + HHKB_SETTLE_MARGIN;
+                if (settle_us > HHKB_SETTLE_US) settle_us = HHKB_SETTLE_US;
+                dprintf("settle: %u us\n", settle_us);
+            }
+        }
+        // key slower than calibrated: raise the wait
+        if (on && settle_full && settle_us < HHKB_SETTLE_US &&
+                on_us + HHKB_SETTLE_MARGIN > settle_us) {
+            settle_us = on_us + HHKB_SETTLE_MARGIN;
+            if (settle_us > HHKB_SETTLE_US) settle_us = HHKB_SETTLE_US;
+            dprintf("settle: %u us\n", settle_us);
+        }
+#endif
+    }
+
+    _delay_us(5);
+    KEY_PREV_OFF();
+    KEY_UNABLE();
+}
+
+static uint8_t next_row(uint16_t rows, uint8_t row)
+{
+    while (row < MATRIX_ROWS && !(rows & (1U<<row))) row++;
+    return row;
+}
+
+/* scan keys of rows(bit per row), other rows keep their previous state */
+static void scan(uint16_t rows)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) matrix[i] = matrix_prev[i];
+
+    uint8_t row = next_row(rows, 0);
+    uint8_t col = 0;
+    if (row == MATRIX_ROWS) return;
+
+    KEY_POWER_ON();
+    select_key(row, col);
+    while (row < MATRIX_ROWS) {
+        read_key(row, col);
+
+        uint8_t r = row;
+        uint8_t c = col + 1;
+        if (c == MATRIX_COLS) {
+            c = 0;
+            r = next_row(rows, row + 1);
+        }
+
+        // NOTE: KEY_STATE keep its state in 20us after KEY_ENABLE.
+        // This takes 25us or more to make sure KEY_STATE returns to idle state.
+#ifdef HHKB_SCAN_PIPELINE
+        // select next key while KEY_STATE returns to idle, this covers 15us of select_key()
+        if (r < MATRIX_ROWS) {
+            KEY_SELECT(r, c);
+            if (matrix_prev[r] & (1<<c)) {
+                KEY_PREV_ON();
+            }
+        }
+        _delay_us(75);
+#else
+        _delay_us(75);
+        if (r < MATRIX_ROWS) {
+            select_key(r, c);
+        }
+#endif
+        row = r;
+        col = c;
+    }
+    KEY_POWER_OFF();
+}
+
 uint8_t matrix_scan(void)
 {
     uint8_t *tmp;
@@ -72,62 +265,47 @@ uint8_t matrix_scan(void)
     matrix_prev = matrix;
     matrix = tmp;
 
-    KEY_POWER_ON();
-    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-            KEY_SELECT(row, col);
-            _delay_us(5);
+    uint16_t rows = ALL_ROWS;
+#ifdef HHKB_FAST_SCAN_TIME
+    // rescan only active rows for a while after full scan
+    if (active_rows && timer_elapsed(full_scan_time) < HHKB_FAST_SCAN_TIME) {
+        rows = active_rows;
+    }
+#endif
 
-            // Not sure this is needed. This just emulates HHKB controller's behaviour.
-            if (matrix_prev[row] & (1<<col)) {
-                KEY_PREV_ON();
-            }
-            _delay_us(10);
-
-            // NOTE: KEY_STATE is valid only in 20us after KEY_ENABLE.
-            // If V-USB interrupts in this section we could lose 40us or so
-            // and would read invalid value from KEY_STATE.
-            uint8_t last = TIMER_RAW;
-
-            KEY_ENABLE();
-
-            // Wait for KEY_STATE outputs its value.
-            // 1us was ok on one HHKB, but not worked on another.
-            // no   wait doesn't work on Teensy++ with pro(1us works)
-            // no   wait does    work on tmk PCB(8MHz) with pro2
-            // 1us  wait does    work on both of above
-            // 1us  wait doesn't work on tmk(16MHz)
-            // 5us  wait does    work on tmk(16MHz)
-            // 5us  wait does    work on tmk(16MHz/2)
-            // 5us  wait does    work on tmk(8MHz)
-            // 10us wait does    work on Teensy++ with pro
-            // 10us wait does    work on 328p+iwrap with pro
-            // 10us wait doesn't work on tmk PCB(8MHz) with pro2(very lagged scan)
-            _delay_us(5);
-
-            if (KEY_STATE()) {
-                matrix[row] &= ~(1<<col);
-            } else {
-                matrix[row] |= (1<<col);
-            }
+#ifdef HHKB_SETTLE_CALIBRATE
+    settle_full = false;
+    if (rows == ALL_ROWS && settle_samples == HHKB_SETTLE_SAMPLES && !--settle_recheck) {
+        settle_recheck = HHKB_SETTLE_RECHECK;
+        settle_full = true;
+    }
+#endif
 
-            // Ignore if this code region execution time elapses more than 20us.
-            // MEMO: 20[us] * (TIMER_RAW_FREQ / 1000000)[count per us]
-            // MEMO: then change above using this rule: a/(b/c) = a*1/(b/c) = a*(c/b)
-            if (TIMER_DIFF_RAW(TIMER_RAW, last) > 20/(1000000/TIMER_RAW_FREQ)) {
-                matrix[row] = matrix_prev[row];
-            }
+    uint16_t t = (uint16_t)timer_read_us();
+    scan(rows);
+    t = (uint16_t)timer_read_us() - t;
+    if (rows == ALL_ROWS) {
+        full_scan_us = t;
+#ifdef HHKB_FAST_SCAN_TIME
+        full_scan_time = timer_read();
+#endif
+    } else {
+        fast_scan_us = t;
+    }
 
-            _delay_us(5);
-            KEY_PREV_OFF();
-            KEY_UNABLE();
+    scan_count++;
+    if (timer_elapsed(scan_rate_time) >= 1000) {
+        scan_rate = scan_count;
+        scan_count = 0;
+        scan_rate_time = timer_read();
+    }
 
-            // NOTE: KEY_STATE keep its state in 20us after KEY_ENABLE.
-            // This takes 25us or more to make sure KEY_STATE returns to idle state.
-            _delay_us(75);
-        }
+#ifdef HHKB_FAST_SCAN_TIME
+    active_rows = 0;
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
+        if (matrix[i] || matrix_prev[i]) active_rows |= (1U<<i);
     }
-    KEY_POWER_OFF();
+#endif
     return 1;
 }
 
@@ -164,4 +342,6 @@ void matrix_print(void)
     for (uint8_t row = 0; row < matrix_rows(); row++) {
         xprintf("%02X: %08b\n", row, bitrev(matrix_get_row(row)));
     }
+    xprintf("scan: full %uus fast %uus %u/s settle %uus\n",
+            full_scan_us, fast_scan_us, scan_rate, settle_us);
 }
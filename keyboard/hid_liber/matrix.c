@@ -16,13 +16,9 @@
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE 0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 // bit array of key state(1:on, 0:off)
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
@@ -150,6 +146,7 @@ void matrix_init(void)
         matrix[i] = 0;
         matrix_debouncing[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
@@ -162,24 +159,12 @@ uint8_t matrix_scan(void)
             bool curr_bit = *row_pin[row] & row_bit[row];
             if (prev_bit != curr_bit) {
                 matrix_debouncing[row] ^= ((matrix_row_t)1<<col);
-                if (debouncing) {
-                    dprintf("bounce!: %02X\n", debouncing);
-                }
-                debouncing = DEBOUNCE;
             }
         }
         release_column(col);
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
-    }
+    debounce(matrix_debouncing, matrix);
 
     return 1;
 }
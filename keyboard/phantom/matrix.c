@@ -11,26 +11,30 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <util/delay.h>
 #include "print.h"
 #include "debug.h"
 #include "util.h"
 #include "matrix.h"
+#include "debounce.h"
+#include "matrix_idle.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	0
-#endif
-static uint8_t debouncing = DEBOUNCE;
-
 // bit array of key state(1:on, 0:off)
 static matrix_row_t matrix[MATRIX_ROWS];
 static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
+// all columns are selected for idle read; they must be unselected before full scan
+static bool cols_all_selected = false;
+// set by pin change interrupt, idle ends on next matrix_scan()
+static volatile bool row_changed = false;
+
 static uint8_t read_rows(void);
 static void init_rows(void);
 static void unselect_cols(void);
 static void select_col(uint8_t col);
+static void select_all_cols(void);
 
 #ifndef SLEEP_LED_ENABLE
 /* LEDs are on output compare pins OC1B OC1C
@@ -90,44 +94,59 @@ void matrix_init(void)
         matrix[i] = 0;
         matrix_debouncing[i] = 0;
     }
+    debounce_init();
 }
 
 uint8_t matrix_scan(void)
 {
+    if (cols_all_selected) {
+        // all columns are selected while idle, any key pulls its row low
+        if (matrix_idle() && !row_changed && !read_rows()) {
+            matrix_idle_sleep();
+            return 1;
+        }
+        PCICR &= ~(1<<PCIE0);
+        row_changed = false;
+        unselect_cols();
+        _delay_us(3);
+        cols_all_selected = false;
+        matrix_idle_wake();
+    }
+
+    bool active = false;
     for (uint8_t col = 0; col < MATRIX_COLS; col++) {  // 0-16
         select_col(col);
         _delay_us(3);       // without this wait it won't read stable value.
         uint8_t rows = read_rows();
+        if (rows) active = true;
         for (uint8_t row = 0; row < MATRIX_ROWS; row++) {  // 0-5
             bool prev_bit = matrix_debouncing[row] & ((matrix_row_t)1<<col);
             bool curr_bit = rows & (1<<row);
             if (prev_bit != curr_bit) {
                 matrix_debouncing[row] ^= ((matrix_row_t)1<<col);
-                if (debouncing) {
-                    dprint("bounce!: "); dprintf("%02X", debouncing); dprintln();
-                }
-                debouncing = DEBOUNCE;
             }
         }
         unselect_cols();
     }
 
-    if (debouncing) {
-        if (--debouncing) {
-            _delay_ms(1);
-        } else {
-            for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-                matrix[i] = matrix_debouncing[i];
-            }
-        }
-    }
+    debounce(matrix_debouncing, matrix);
 
+    if (matrix_idle_update(active || debounce_active())) {
+        select_all_cols();
+        cols_all_selected = true;
+#ifdef MATRIX_IDLE_ENABLE
+        // wake on any row falling, this also wakes MCU from power down in suspend
+        PCMSK0 |= 0b00111111;
+        PCIFR = (1<<PCIF0);
+        PCICR |= (1<<PCIE0);
+#endif
+    }
     return 1;
 }
 
 bool matrix_is_modified(void)
 {
-    if (debouncing) return false;
+    if (debounce_active()) return false;
     return true;
 }
 
@@ -160,6 +179,15 @@ uint8_t matrix_key_count(void)
     return count;
 }
 
+#ifdef MATRIX_IDLE_ENABLE
+ISR(PCINT0_vect)
+{
+    // columns are still all selected, matrix_scan() unselects them before full scan
+    PCICR &= ~(1<<PCIE0);
+    row_changed = true;
+}
+#endif
+
 /* Row pin configuration
  * row: 0   1   2   3   4   5
  * pin: B5  B4  B3  B2  B1  B0
@@ -272,3 +300,11 @@ static void select_col(uint8_t col)
             break;
     }
 }
+
+static void select_all_cols(void)
+{
+    PORTC &= ~0b11000000;
+    PORTD &= ~0b11111111;
+    PORTE &= ~0b01000000;
+    PORTF &= ~0b11110011;
+}
@@ -122,11 +122,22 @@ bool adb_host_psw(void)
 // [from Apple IIgs Hardware Reference Second Edition]
 
 uint16_t adb_host_kbd_recv(void)
+{
+    return adb_host_talk(ADB_TALK(ADB_ADDR_KEYBOARD, 0));  // 0x2C
+}
+
+uint16_t adb_host_mouse_recv(void)
+{
+    return adb_host_talk(ADB_TALK(ADB_ADDR_MOUSE, 0));     // 0x3C
+}
+
+/* Talk command: returns 16-bit data of register, 0 when device has no data to send */
+uint16_t adb_host_talk(uint8_t cmd)
 {
     uint16_t data = 0;
     cli();
     attention();
-    send_byte(0x2C);            // Addr:Keyboard(0010), Cmd:Talk(11), Register0(00)
+    send_byte(cmd);
     place_bit0();               // Stopbit(0)
     if (!wait_data_hi(500)) {    // Service Request(310us Adjustable Keyboard): just ignored
         sei();
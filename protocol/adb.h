@@ -51,11 +51,20 @@ POSSIBILITY OF SUCH DAMAGE.
 #define ADB_POWER       0x7F
 #define ADB_CAPS        0x39
 
+// command byte: Addr(7-4) Cmd(3-2) Register(1-0)
+#define ADB_ADDR_KEYBOARD   2
+#define ADB_ADDR_MOUSE      3
+#define ADB_CMD_LISTEN      0x08
+#define ADB_CMD_TALK        0x0C
+#define ADB_TALK(addr, reg) ((addr)<<4 | ADB_CMD_TALK | (reg))
+
 
 // ADB host
 void     adb_host_init(void);
 bool     adb_host_psw(void);
+uint16_t adb_host_talk(uint8_t cmd);
 uint16_t adb_host_kbd_recv(void);
+uint16_t adb_host_mouse_recv(void);
 void     adb_host_listen(uint8_t cmd, uint8_t data_h, uint8_t data_l);
 void     adb_host_kbd_led(uint8_t led);
 
@@ -28,40 +28,203 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <string.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
 #include "keycode.h"
 #include "suart.h"
 #include "uart.h"
 #include "report.h"
+#include "host.h"
 #include "host_driver.h"
 #include "iwrap.h"
 #include "print.h"
+#include "timer.h"
 #include <avr/eeprom.h>
 
 
 /* iWRAP MUX mode utils. 3.10 HID raw mode(iWRAP_HID_Application_Note.pdf) */
 #define MUX_HEADER(LINK, LENGTH) do { \
-    xmit(0xbf);     /* SOF    */ \
-    xmit(LINK);     /* Link   */ \
-    xmit(0x00);     /* Flags  */ \
-    xmit(LENGTH);   /* Length */ \
+    tx_enq(0xbf);   /* SOF    */ \
+    tx_enq(LINK);   /* Link   */ \
+    tx_enq(0x00);   /* Flags  */ \
+    tx_enq(LENGTH); /* Length */ \
 } while (0)
-#define MUX_FOOTER(LINK) xmit(LINK^0xff)
+#define MUX_FOOTER(LINK) tx_enq(LINK^0xff)
 
 
 static uint8_t connected = 0;
+static bool failed = false;
 //static uint8_t channel = 1;
 
+
+/*
+ * Transmit queue
+ *
+ * Frames are put into queue without waiting and sent from it in background.
+ * Software UART is clocked out by Timer2 compare interrupt, one bit per
+ * period, so neither keyboard scan nor other interrupts wait for the 38.4kbps
+ * line. With NO_SUART_PORT iwrap_task() moves bytes into buffer of hardware
+ * UART, which is sent by its own interrupt. A frame is put entirely or not at
+ * all; report which finds no room is kept as pending and queued by
+ * iwrap_task() later, see send_report().
+ */
+#ifndef IWRAP_TX_BUF_SIZE
+#define IWRAP_TX_BUF_SIZE       128
+#endif
+/* MUX frame of HID report: MUX header(4) + HID raw header(4) + data + footer(1) */
+#define REPORT_FRAME_SIZE(len)  ((len) + 9)
+static volatile uint8_t tx_buf[IWRAP_TX_BUF_SIZE];
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+
+static uint8_t tx_space(void)
+{
+    return (tx_tail + IWRAP_TX_BUF_SIZE - tx_head - 1) % IWRAP_TX_BUF_SIZE;
+}
+
+static void tx_enq(uint8_t c)
+{
+    tx_buf[tx_head] = c;
+    tx_head = (tx_head + 1) % IWRAP_TX_BUF_SIZE;
+}
+
+#ifdef NO_SUART_PORT
+/* bytes moved per iwrap_task() call, within hardware UART TX_BUFFER_SIZE */
+#ifndef IWRAP_TX_BYTES_PER_TASK
+#define IWRAP_TX_BYTES_PER_TASK REPORT_FRAME_SIZE(8)
+#endif
+
+static void tx_start(void)
+{
+    for (uint8_t n = IWRAP_TX_BYTES_PER_TASK; n && tx_tail != tx_head; n--) {
+        xmit(tx_buf[tx_tail]);
+        tx_tail = (tx_tail + 1) % IWRAP_TX_BUF_SIZE;
+    }
+}
+
+static bool tx_busy(void)
+{
+    return tx_tail != tx_head;
+}
+#else
+/* bit rate of suart.S(BPS) */
+#ifndef IWRAP_SUART_BAUD
+#define IWRAP_SUART_BAUD        38400
+#endif
+#define TX_TIMER_TOP    ((F_CPU / 8 + IWRAP_SUART_BAUD / 2) / IWRAP_SUART_BAUD - 1)
+#if TX_TIMER_TOP > 255
+#   error "IWRAP_SUART_BAUD is too low for Timer2 with clk/8"
+#endif
+
+/* start Timer2 interrupt unless it is sending already */
+static void tx_start(void)
+{
+    if (TIMSK2 & (1<<OCIE2A)) return;
+    if (tx_tail == tx_head) return;
+    TCCR2A = (1<<WGM21);    // CTC
+    TCCR2B = (1<<CS21);     // clk/8
+    OCR2A = TX_TIMER_TOP;
+    TCNT2 = 0;
+    TIFR2 = (1<<OCF2A);
+    TIMSK2 |= (1<<OCIE2A);
+}
+
+static bool tx_busy(void)
+{
+    return TIMSK2 & (1<<OCIE2A);
+}
+
+/*
+ * Puts one bit of N81 frame each bit period: start bit, data LSB first and
+ * stop bit. Stops timer when queue is empty after stop bit. A byte being
+ * received by recv() in PCINT ISR delays bits, iWRAP sends mostly responses
+ * to commands which are sent one at a time.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+    static uint8_t bit = 0;
+    static uint8_t data;
+    if (bit == 0) {
+        if (tx_tail == tx_head) {
+            TIMSK2 &= ~(1<<OCIE2A);
+            TCCR2B = 0;
+            return;
+        }
+        data = tx_buf[tx_tail];
+        tx_tail = (tx_tail + 1) % IWRAP_TX_BUF_SIZE;
+        SUART_OUT_PORT &= ~(1<<SUART_OUT_BIT);
+    } else if (bit <= 8) {
+        if (data & 1)
+            SUART_OUT_PORT |= (1<<SUART_OUT_BIT);
+        else
+            SUART_OUT_PORT &= ~(1<<SUART_OUT_BIT);
+        data >>= 1;
+    } else {
+        SUART_OUT_PORT |= (1<<SUART_OUT_BIT);
+    }
+    if (++bit == 10) bit = 0;
+}
+#endif
+
+/* send all queued bytes */
+static void tx_flush(void)
+{
+    do {
+        tx_start();
+    } while (tx_busy());
+}
+
+static bool mux_send(const char *s)
+{
+    uint8_t len = strlen(s);
+    if (tx_space() < len + 5) return false;
+    MUX_HEADER(0xff, len);
+    while (*s)
+        tx_enq(*s++);
+    MUX_FOOTER(0xff);
+    return true;
+}
+
+
+/*
+ * MUX deframer: takes bytes from iWRAP one by one and returns true for data
+ * bytes. Runs in PCINT ISR with software UART and in receive() with hardware
+ * UART, whose buffer holds MUX frames as they are.
+ */
+static bool mux_recv(uint8_t c)
+{
+    static uint8_t mux_state = 0xff;
+    switch (mux_state) {
+        case 0xff: // SOF
+            if (c == 0xbf)
+                mux_state--;
+            break;
+        case 0xfe: // Link
+        case 0xfd: // Flags
+            mux_state--;
+            break;
+        case 0xfc: // Length
+            mux_state = c;
+            break;
+        case 0x00: // nLink
+            mux_state = 0xff;
+            break;
+        default:
+            mux_state--;
+            return true;
+    }
+    return false;
+}
+
+
 /* iWRAP buffer */
 #ifndef NO_SUART_PORT
 #define MUX_BUF_SIZE 64
 static char buf[MUX_BUF_SIZE];
 static uint8_t snd_pos = 0;
 
-#define MUX_RCV_BUF_SIZE 256
+#define MUX_RCV_BUF_SIZE 128
 static char rcv_buf[MUX_RCV_BUF_SIZE];
-static uint8_t rcv_head = 0;
-static uint8_t rcv_tail = 0;
+static volatile uint8_t rcv_head = 0;
+static volatile uint8_t rcv_tail = 0;
 
 
 /* receive buffer */
@@ -84,56 +247,292 @@ static char rcv_deq(void)
     return c;
 }
 
+/* iWRAP response */
+ISR(PCINT1_vect, ISR_BLOCK) // recv() runs away in case of ISR_NOBLOCK
+{
+    if ((SUART_IN_PIN & (1<<SUART_IN_BIT)))
+        return;
+
+    uint8_t c = recv();
+    if (mux_recv(c)) {
+        uart_putchar(c);
+        rcv_enq(c);
+    }
+}
+#endif
+
+
+/*------------------------------------------------------------------*
+ * Connection state machine
+ *------------------------------------------------------------------*/
 /*
-static char rcv_peek(void)
+ * Commands are requested by iwrap_call() and others and started by
+ * iwrap_task() one at a time. Responses are read line by line from MUX
+ * frames received by interrupt and advance the state, or timeout does.
+ * Nothing waits here for iWRAP.
+ */
+#define IWRAP_RESET_TIME    3000    /* boot after RESET */
+#define IWRAP_MUX_TIME      500     /* SET CONTROL MUX */
+#define IWRAP_RESPONSE_TIME 500     /* response to LIST and SET BT PAIR */
+#define IWRAP_CALL_TIME     5000    /* CONNECT after CALL */
+
+enum {
+    IWRAP_RESET,        /* RESET sent */
+    IWRAP_MUX,          /* SET CONTROL MUX sent */
+    IWRAP_READY,
+    IWRAP_CHECK,        /* LIST sent */
+    IWRAP_PAIR,         /* SET BT PAIR sent to CALL paired device */
+    IWRAP_CALL,         /* CALL sent */
+    IWRAP_KILL,         /* LIST sent to KILL connection */
+    IWRAP_UNPAIR,       /* SET BT PAIR sent to remove pairing */
+#ifdef NO_SUART_PORT
+    IWRAP_RING,         /* waiting RING from unknown device */
+#endif
+};
+static uint8_t state = IWRAP_READY;
+static uint16_t state_time = 0;
+
+#define REQ_CHECK   (1<<0)
+#define REQ_CALL    (1<<1)
+#define REQ_KILL    (1<<2)
+#define REQ_UNPAIR  (1<<3)
+static uint8_t requests = 0;
+
+#define MAC_SIZE 17
+static char cmd[40];
+
+#ifdef NO_SUART_PORT
+/* index of paired device to CALL, 3 tries devices of RING */
+static uint8_t call_index;
+static char ring_mac[MAC_SIZE];
+#endif
+
+/* response line, truncated */
+#define LINE_SIZE 64
+static char line[LINE_SIZE];
+static uint8_t line_pos = 0;
+
+
+static void report_queue_pending(void);
+
+static void set_state(uint8_t s)
 {
-    if (rcv_head == rcv_tail)
-        return 0;
-    return rcv_buf[rcv_tail];
+    state = s;
+    state_time = timer_read();
 }
-*/
 
-static void rcv_clear(void)
+/* pointer to nth field separated by space or NULL */
+static const char *field(const char *s, uint8_t n)
 {
-    rcv_tail = rcv_head = 0;
+    while (n--) {
+        while (*s && *s != ' ') s++;
+        if (!*s) return NULL;
+        s++;
+    }
+    return *s ? s : NULL;
 }
 
-/* iWRAP response */
-ISR(PCINT1_vect, ISR_BLOCK) // recv() runs away in case of ISR_NOBLOCK
+/* command followed by MAC address and rest */
+static bool mux_send_mac(const char *command, const char *mac, const char *rest)
 {
-    if ((SUART_IN_PIN & (1<<SUART_IN_BIT)))
+    strcpy(cmd, command);
+    strncat(cmd, mac, MAC_SIZE);
+    strcat(cmd, rest);
+    return mux_send(cmd);
+}
+
+#ifdef NO_SUART_PORT
+static void call_next(void)
+{
+    if (call_index < 3) {
+        char mac[MAC_SIZE + 1] = {};
+        paired_device_info_t *info = (paired_device_info_t *)PAIRED_DEVICE_INFO_ADDR;
+        eeprom_read_block(mac, info->macAddr[call_index++], MAC_SIZE);
+        mux_send_mac("CALL ", mac, " 11 HID");
+        set_state(IWRAP_CALL);
+    } else {
+        // didn't connect to known remote device, wait for RING
+        set_state(IWRAP_RING);
+    }
+}
+
+static void save_ring_mac(void)
+{
+    paired_device_info_t *info = (paired_device_info_t *)PAIRED_DEVICE_INFO_ADDR;
+    uint8_t index = (eeprom_read_byte(&info->lastPairedIndex) + 1) % 3;
+    eeprom_write_block(ring_mac, info->macAddr[index], MAC_SIZE);
+    eeprom_write_byte(&info->lastPairedIndex, index);
+}
+#endif
+
+static void call_end(void)
+{
+#ifdef NO_SUART_PORT
+    if (!connected) {
+        call_next();
         return;
+    }
+#endif
+    set_state(IWRAP_READY);
+    requests |= REQ_CHECK;
+}
 
-    static volatile uint8_t mux_state = 0xff;
-    static volatile uint8_t mux_link = 0xff;
-    uint8_t c = recv();
-    switch (mux_state) {
-        case 0xff: // SOF
-            if (c == 0xbf)
-                mux_state--;
+static void handle_line(void)
+{
+    if (!strncmp(line, "SYNTAX ERROR", 12)) {
+        failed = true;
+    } else if (!strncmp(line, "LIST ", 5)) {
+        const char *mac = field(line, 10);
+        if (!mac) {
+            // number of connections
+            connected = strncmp(line, "LIST 0", 6) ? 1 : 0;
+            if (state == IWRAP_CHECK) {
+                set_state(IWRAP_READY);
+            } else if (state == IWRAP_KILL && !connected) {
+                print("no connection to kill.\n");
+                set_state(IWRAP_READY);
+            }
+        } else if (state == IWRAP_KILL) {
+            mux_send_mac("KILL ", mac, "");
+            requests |= REQ_CHECK;
+            set_state(IWRAP_READY);
+        }
+    } else if (!strncmp(line, "SET BT PAIR ", 12)) {
+        const char *mac = line + 12;
+        if (state == IWRAP_PAIR) {
+            mux_send_mac("CALL ", mac, " 11 HID");
+            set_state(IWRAP_CALL);
+        } else if (state == IWRAP_UNPAIR) {
+            mux_send_mac("SET BT PAIR ", mac, "");
+            set_state(IWRAP_READY);
+        }
+    } else if (!strncmp(line, "CONNECT ", 8)) {
+        connected = 1;
+        if (state == IWRAP_CALL) {
+#ifdef NO_SUART_PORT
+            if (call_index > 3) save_ring_mac();
+#endif
+            set_state(IWRAP_READY);
+        } else if (state == IWRAP_CHECK) {
+            set_state(IWRAP_READY);
+        }
+    } else if (!strncmp(line, "NO CARRIER ", 11)) {
+        connected = 0;
+        if (state == IWRAP_CALL) call_end();
+        else if (state == IWRAP_CHECK) set_state(IWRAP_READY);
+#ifdef NO_SUART_PORT
+    } else if (!strncmp(line, "RING ", 5)) {
+        const char *mac = field(line, 2);
+        if (state == IWRAP_RING && mac) {
+            strncpy(ring_mac, mac, MAC_SIZE);
+            mux_send_mac("CALL ", ring_mac, " 11 HID");
+            call_index = 4;     // CALL for RING
+            set_state(IWRAP_CALL);
+        }
+#endif
+    }
+}
+
+static void receive_char(char c)
+{
+    if (c == '\r') return;
+    if (c == '\n') {
+        line[line_pos] = '\0';
+        line_pos = 0;
+        handle_line();
+    } else if (line_pos < LINE_SIZE - 1) {
+        line[line_pos++] = c;
+    }
+}
+
+static void receive(void)
+{
+#ifdef NO_SUART_PORT
+    /* raw MUX frames, 0x00 of header and footer is not end of data */
+    while (uart_available()) {
+        char c = rcv_deq();
+        if (mux_recv(c))
+            receive_char(c);
+    }
+#else
+    char c;
+    while ((c = rcv_deq()))
+        receive_char(c);
+#endif
+}
+
+static void start_request(void)
+{
+    if (requests & REQ_CALL) {
+#ifdef NO_SUART_PORT
+        requests &= ~REQ_CALL;
+        call_index = 0;
+        call_next();
+#else
+        if (!mux_send("SET BT PAIR")) return;
+        requests &= ~REQ_CALL;
+        set_state(IWRAP_PAIR);
+#endif
+    } else if (requests & REQ_KILL) {
+        if (!mux_send("LIST")) return;
+        requests &= ~REQ_KILL;
+        set_state(IWRAP_KILL);
+    } else if (requests & REQ_UNPAIR) {
+        if (!mux_send("SET BT PAIR")) return;
+        requests &= ~REQ_UNPAIR;
+        set_state(IWRAP_UNPAIR);
+    } else if (requests & REQ_CHECK) {
+        if (!mux_send("LIST")) return;
+        requests &= ~REQ_CHECK;
+        set_state(IWRAP_CHECK);
+    }
+}
+
+void iwrap_task(void)
+{
+    receive();
+
+    uint16_t elapsed = timer_elapsed(state_time);
+    switch (state) {
+        case IWRAP_RESET:
+            if (elapsed >= IWRAP_RESET_TIME) {
+                iwrap_send("\r\nSET CONTROL MUX 1\r\n");
+                set_state(IWRAP_MUX);
+            }
             break;
-        case 0xfe: // Link
-            mux_state--;
-            mux_link = c;
+        case IWRAP_MUX:
+            if (elapsed >= IWRAP_MUX_TIME) {
+                requests |= REQ_CHECK;
+                set_state(IWRAP_READY);
+            }
             break;
-        case 0xfd: // Flags
-            mux_state--;
+        case IWRAP_READY:
+            start_request();
             break;
-        case 0xfc: // Length
-            mux_state = c;
+        case IWRAP_CHECK:
+            if (elapsed >= IWRAP_RESPONSE_TIME) {
+                connected = 0;
+                set_state(IWRAP_READY);
+            }
             break;
-        case 0x00:
-            mux_state = 0xff;
-            mux_link = 0xff;
+        case IWRAP_PAIR:
+        case IWRAP_KILL:
+        case IWRAP_UNPAIR:
+            if (elapsed >= IWRAP_RESPONSE_TIME) {
+                set_state(IWRAP_READY);
+            }
             break;
-        default:
-            if (mux_state--) {
-                uart_putchar(c);
-                rcv_enq(c);
+        case IWRAP_CALL:
+            if (elapsed >= IWRAP_CALL_TIME) {
+                call_end();
             }
+            break;
     }
+
+    report_queue_pending();
+    tx_start();
 }
-#endif
+
 
 /*------------------------------------------------------------------*
  * iWRAP communication
@@ -143,24 +542,19 @@ void iwrap_init(void)
     // reset iWRAP if in already MUX mode after AVR software-reset
     iwrap_send("RESET");
     iwrap_mux_send("RESET");
-    _delay_ms(3000);
-    iwrap_send("\r\nSET CONTROL MUX 1\r\n");
-    _delay_ms(500);
-    iwrap_check_connection();
+    set_state(IWRAP_RESET);
 }
 
 void iwrap_mux_send(const char *s)
 {
-    rcv_clear();
-    MUX_HEADER(0xff, strlen((char *)s));
-    iwrap_send(s);
-    MUX_FOOTER(0xff);
+    mux_send(s);
 }
 
 void iwrap_send(const char *s)
 {
+    if (tx_space() < strlen(s)) return;
     while (*s)
-        xmit(*s++);
+        tx_enq(*s++);
 }
 #ifndef NO_SUART_PORT
 /* send buffer */
@@ -183,214 +577,28 @@ void iwrap_buf_send(void)
     snd_pos = 0;
     iwrap_mux_send(buf);
 }
+#endif
 
 void iwrap_call(void)
 {
-    char *p;
-
-    iwrap_mux_send("SET BT PAIR");
-    _delay_ms(500);
-
-    p = rcv_buf + rcv_tail;
-    while (!strncmp(p, "SET BT PAIR", 11)) {
-        p += 7;
-        strncpy(p, "CALL", 4);
-        strncpy(p+22, " 11 HID\n\0", 9);
-        print_S(p);
-        iwrap_mux_send(p);
-        // TODO: skip to next line
-        p += 57;
-
-        DEBUG_LED_CONFIG;
-        DEBUG_LED_ON;
-        _delay_ms(500);
-        DEBUG_LED_OFF;
-        _delay_ms(500);
-        DEBUG_LED_ON;
-        _delay_ms(500);
-        DEBUG_LED_OFF;
-        _delay_ms(500);
-        DEBUG_LED_ON;
-        _delay_ms(500);
-        DEBUG_LED_OFF;
-        _delay_ms(500);
-        DEBUG_LED_ON;
-        _delay_ms(500);
-        DEBUG_LED_OFF;
-        _delay_ms(500);
-        DEBUG_LED_ON;
-        _delay_ms(500);
-        DEBUG_LED_OFF;
-        _delay_ms(500);
-    }
-    iwrap_check_connection();
-}
-
-void iwrap_kill(void)
-{
-    char c;
-    iwrap_mux_send("LIST");
-    _delay_ms(500);
-
-    while ((c = rcv_deq()) && c != '\n') ;
-    if (strncmp(rcv_buf + rcv_tail, "LIST ", 5)) {
-        print("no connection to kill.\n");
-        return;
-    }
-    // skip 10 'space' chars
-    for (uint8_t i = 10; i; i--)
-        while ((c = rcv_deq()) && c != ' ') ;
-
-    char *p = rcv_buf + rcv_tail - 5;
-    strncpy(p, "KILL ", 5);
-    strncpy(p + 22, "\n\0", 2);
-    print_S(p);
-    iwrap_mux_send(p);
-    _delay_ms(500);
-
-    iwrap_check_connection();
-}
-
-void iwrap_unpair(void)
-{
-    iwrap_mux_send("SET BT PAIR");
-    _delay_ms(500);
-
-    char *p = rcv_buf + rcv_tail;
-    if (!strncmp(p, "SET BT PAIR", 11)) {
-        strncpy(p+29, "\n\0", 2);
-        print_S(p);
-        iwrap_mux_send(p);
-    }
-}
-#else
-void iwrap_call(void)
-{
-    //char *p;
-	//char c;
-	uint8_t i = 0;
-    char *callCmd = "CALL REPLACE_ME_BY_MAC 11 HID";
-    //pair known remote device
-    //iwrap_mux_send("SET BT PAIR");
-    //_delay_ms(500);
-	paired_device_info_t paired_device_info;
-    while(!eeprom_is_ready());
-	eeprom_read_block(&paired_device_info, PAIRED_DEVICE_INFO_ADDR, sizeof(paired_device_info_t));
-		
-    //p = (char *)get_rx_buf();
-	for(i = 0;i < 3;i++)
-	{
-	  strncpy(callCmd+5, paired_device_info.macAddr[i], 17);
-	  iwrap_mux_send(callCmd);
-      _delay_ms(5000);
-	  if(iwrap_check_connection())
-		return;
-	  _delay_ms(500);
-	#if 0
-	  if(0 == strncmp(p, "SET BT PAIR", 11))
-	  {
-	    p += 7;
-        strncpy(p, "CALL", 4);
-        strncpy(p+22, " 11 HID", 8);
-        iwrap_mux_send(p);
-		_delay_ms(500);
-		if(iwrap_check_connection())
-			break;
-	  }
-	  #endif
-	}
-
-	if(3 == i)
-	{
-	  //didn't connect to known remote device
-	  //clear receive buffer, prepare for receive RING
-	  rcv_clear();
-	  memset(get_rx_buf(), 0x00, RX_BUFFER_SIZE);
-	  while(1)
-	  {
-		if(('R' == rcv_deq()) 
-			&& ('I' == rcv_deq())
-			&& ('N' == rcv_deq())
-			&& ('G' == rcv_deq()))
-		{
-		  
-		  char macAddr[17];
-		  //pop up space
-		  rcv_deq();
-		  //pop up link id
-		  rcv_deq();
-		  //pop up space
-		  rcv_deq();
-		  //pop up mac address
-		  for(int k = 0;k < 17;k++)
-		  {
-		    macAddr[k] = rcv_deq();
-		  }
-		  strncpy(callCmd + 5, macAddr, 17);
-		  iwrap_mux_send(callCmd);
-		  _delay_ms(500);
-
-		  if(iwrap_check_connection())
-		  {
-		    uint8_t currentPairedIndex = (paired_device_info.lastPairedIndex + 1) % 3;
-			strncpy(paired_device_info.macAddr[currentPairedIndex], macAddr, 17);
-			paired_device_info.lastPairedIndex = currentPairedIndex;
-			while(!eeprom_is_ready());
-			eeprom_write_block(&paired_device_info, PAIRED_DEVICE_INFO_ADDR, sizeof(paired_device_info_t));
-			return;
-		  }
-		  _delay_ms(500);
-		}
-		else
-		  _delay_ms(100);
-	  }	
-	}
+    requests |= REQ_CALL;
 }
 
 void iwrap_kill(void)
 {
-    char c;
-    iwrap_mux_send("LIST");
-    _delay_ms(500);
-
-    while ((c = rcv_deq()) && c != '\n') ;
-    if (strncmp((const char *)get_rx_buf_tail(), "LIST ", 5)) {
-        print("no connection to kill.\n");
-        return;
-    }
-    // skip 10 'space' chars
-    for (uint8_t i = 10; i; i--)
-        while ((c = rcv_deq()) && c != ' ') ;
-
-    char *p = (char *)(get_rx_buf_tail() - 5);
-    strncpy(p, "KILL ", 5);
-    strncpy(p + 22, "\n\0", 2);
-    print_S(p);
-    iwrap_mux_send(p);
-    _delay_ms(500);
-
-    iwrap_check_connection();
+    requests |= REQ_KILL;
 }
 
 void iwrap_unpair(void)
 {
-    iwrap_mux_send("SET BT PAIR");
-    _delay_ms(500);
-
-    char *p = (char *)get_rx_buf_tail();
-    if (!strncmp(p, "SET BT PAIR", 11)) {
-        strncpy(p+29, "\n\0", 2);
-        print_S(p);
-        iwrap_mux_send(p);
-    }
+    requests |= REQ_UNPAIR;
 }
 
-#endif
-
-
 void iwrap_sleep(void)
 {
     iwrap_mux_send("SLEEP");
+    // MCU sleeps after this
+    tx_flush();
 }
 
 void iwrap_sniff(void)
@@ -400,53 +608,22 @@ void iwrap_sniff(void)
 void iwrap_subrate(void)
 {
 }
-#ifndef NO_SUART_PORT
-bool iwrap_failed(void)
-{
-    if (strncmp(rcv_buf, "SYNTAX ERROR", 12))
-        return true;
-    else
-        return false;
-}
-#else
+
 bool iwrap_failed(void)
 {
-    if (strncmp((const char *)get_rx_buf(), "SYNTAX ERROR", 12))
-        return true;
-    else
-        return false;
+    return failed;
 }
-#endif
 
 uint8_t iwrap_connected(void)
 {
     return connected;
 }
-#ifndef NO_SUART_PORT
-uint8_t iwrap_check_connection(void)
-{
-    iwrap_mux_send("LIST");
-    _delay_ms(100);
 
-    if (strncmp(rcv_buf, "LIST ", 5) || !strncmp((const char *)rcv_buf, "LIST 0", 6))
-        connected = 0;
-    else
-        connected = 1;
-    return connected;
-}
-#else
 uint8_t iwrap_check_connection(void)
 {
-    iwrap_mux_send("LIST");
-    _delay_ms(100);
-
-    if (strncmp((const char *)get_rx_buf(), "LIST ", 5) || !strncmp((const char *)get_rx_buf(), "LIST 0", 6))
-        connected = 0;
-    else
-        connected = 1;
+    requests |= REQ_CHECK;
     return connected;
 }
-#endif
 
 
 /*------------------------------------------------------------------*
@@ -475,42 +652,173 @@ static uint8_t keyboard_leds(void) {
     return 0;
 }
 
-static void send_keyboard(report_keyboard_t *report)
+/* report id of iWRAP HID profile */
+#define HID_ID_KEYBOARD     1
+#define HID_ID_MOUSE        2
+#define HID_ID_CONSUMER     3
+
+/*
+ * HID raw mode: DATA(Input) report on link 1, dropped while disconnected.
+ *
+ * Report which doesn't fit in transmit queue, or comes while others are
+ * waiting, is held in pending queue and iwrap_task() queues it in order when
+ * room is made. Report same as the last pending one of its id is dropped and
+ * mouse motion with the same buttons is added up, but a change of keys or
+ * buttons is never merged away. When pending queue is full the oldest report
+ * followed by newer one of its id gives way, so latest state of each id still
+ * reaches host; macro player waits by host_send_busy() before this.
+ */
+#ifndef IWRAP_REPORT_PENDING
+#define IWRAP_REPORT_PENDING    8
+#endif
+#if (IWRAP_REPORT_PENDING < 4)
+#   error "IWRAP_REPORT_PENDING must be 4 or more"
+#endif
+typedef struct {
+    uint8_t id;
+    uint8_t len;
+    uint8_t data[8];
+} pending_report_t;
+static pending_report_t pending[IWRAP_REPORT_PENDING];
+static uint8_t pending_head = 0;
+static uint8_t pending_len = 0;
+
+static void report_enq(uint8_t id, const uint8_t *data, uint8_t len)
 {
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
-    MUX_HEADER(0x01, 0x0c);
+    MUX_HEADER(0x01, len + 4);
     // HID raw mode header
-    xmit(0x9f);
-    xmit(0x0a); // Length
-    xmit(0xa1); // DATA(Input)
-    xmit(0x01); // Report ID
-    xmit(report->mods);
-    xmit(0x00); // reserved byte(always 0)
-    xmit(report->keys[0]);
-    xmit(report->keys[1]);
-    xmit(report->keys[2]);
-    xmit(report->keys[3]);
-    xmit(report->keys[4]);
-    xmit(report->keys[5]);
+    tx_enq(0x9f);
+    tx_enq(len + 2);    // Length
+    tx_enq(0xa1);       // DATA(Input)
+    tx_enq(id);         // Report ID
+    while (len--)
+        tx_enq(*data++);
     MUX_FOOTER(0x01);
 }
 
+#define PENDING(i)  (&pending[(pending_head + (i)) % IWRAP_REPORT_PENDING])
+
+static pending_report_t *pending_last(uint8_t id)
+{
+    for (uint8_t i = pending_len; i; i--) {
+        pending_report_t *r = PENDING(i - 1);
+        if (r->id == id) return r;
+    }
+    return 0;
+}
+
+static bool add_motion(uint8_t *a, uint8_t b)
+{
+    int16_t v = (int8_t)*a + (int8_t)b;
+    if (v < -127 || v > 127) return false;
+    *a = v;
+    return true;
+}
+
+/* merge into last pending report of the id unless keys or buttons change */
+static bool pending_merge(uint8_t id, const uint8_t *data, uint8_t len)
+{
+    pending_report_t *r = pending_last(id);
+    if (!r) return false;
+    if (!memcmp(r->data, data, len)) return true;
+    if (id != HID_ID_MOUSE || r->data[0] != data[0]) return false;
+
+    uint8_t sum[4];
+    memcpy(sum, &r->data[1], 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        if (!add_motion(&sum[i], data[i + 1])) return false;
+    }
+    memcpy(&r->data[1], sum, 4);
+    return true;
+}
+
+/* remove oldest report which has newer one of its id, full queue has one */
+static void pending_drop_superseded(void)
+{
+    uint8_t i = 0;
+    while (i < pending_len - 1) {
+        uint8_t j;
+        for (j = i + 1; j < pending_len; j++) {
+            if (PENDING(j)->id == PENDING(i)->id) break;
+        }
+        if (j < pending_len) break;
+        i++;
+    }
+    for (; i < pending_len - 1; i++) {
+        *PENDING(i) = *PENDING(i + 1);
+    }
+}
+
+static void send_report(uint8_t id, const uint8_t *data, uint8_t len)
+{
+    if (!iwrap_connected()) {
+        iwrap_check_connection();
+        return;
+    }
+    if (!pending_len && tx_space() >= REPORT_FRAME_SIZE(len)) {
+        report_enq(id, data, len);
+        return;
+    }
+    if (pending_merge(id, data, len)) return;
+
+    if (pending_len == IWRAP_REPORT_PENDING) {
+        pending_drop_superseded();
+        pending_len--;
+    }
+    pending_report_t *r = PENDING(pending_len++);
+    r->id = id;
+    r->len = len;
+    memcpy(r->data, data, len);
+}
+
+static void report_queue_pending(void)
+{
+    if (!iwrap_connected()) {
+        pending_len = 0;
+        return;
+    }
+    while (pending_len) {
+        pending_report_t *r = PENDING(0);
+        if (tx_space() < REPORT_FRAME_SIZE(r->len)) return;
+        report_enq(r->id, r->data, r->len);
+        pending_head = (pending_head + 1) % IWRAP_REPORT_PENDING;
+        pending_len--;
+    }
+}
+
+/* next report would be pending; macro player waits for this */
+bool host_send_busy(void)
+{
+    return iwrap_connected() &&
+           (pending_len || tx_space() < REPORT_FRAME_SIZE(8));
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    uint8_t data[8] = {
+        report->mods,
+        0x00, // reserved byte(always 0)
+        report->keys[0],
+        report->keys[1],
+        report->keys[2],
+        report->keys[3],
+        report->keys[4],
+        report->keys[5]
+    };
+    send_report(HID_ID_KEYBOARD, data, sizeof(data));
+}
+
 static void send_mouse(report_mouse_t *report)
 {
 #if defined(MOUSEKEY_ENABLE) || defined(PS2_MOUSE_ENABLE)
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
-    MUX_HEADER(0x01, 0x09);
-    // HID raw mode header
-    xmit(0x9f);
-    xmit(0x07); // Length
-    xmit(0xa1); // DATA(Input)
-    xmit(0x02); // Report ID
-    xmit(report->buttons);
-    xmit(report->x);
-    xmit(report->y);
-    xmit(report->v);
-    xmit(report->h);
-    MUX_FOOTER(0x01);
+    uint8_t data[5] = {
+        report->buttons,
+        report->x,
+        report->y,
+        report->v,
+        report->h
+    };
+    send_report(HID_ID_MOUSE, data, sizeof(data));
 #endif
 }
 
@@ -527,7 +835,10 @@ static void send_consumer(uint16_t data)
     uint8_t bits2 = 0;
     uint8_t bits3 = 0;
 
-    if (!iwrap_connected() && !iwrap_check_connection()) return;
+    if (!iwrap_connected()) {
+        iwrap_check_connection();
+        return;
+    }
     if (data == last_data) return;
     last_data = data;
 
@@ -604,14 +915,7 @@ static void send_consumer(uint16_t data)
             break;
     }
 
-    MUX_HEADER(0x01, 0x07);
-    xmit(0x9f);
-    xmit(0x05); // Length
-    xmit(0xa1); // DATA(Input)
-    xmit(0x03); // Report ID
-    xmit(bits1);
-    xmit(bits2);
-    xmit(bits3);
-    MUX_FOOTER(0x01);
+    uint8_t report[3] = { bits1, bits2, bits3 };
+    send_report(HID_ID_CONSUMER, report, sizeof(report));
 #endif
 }
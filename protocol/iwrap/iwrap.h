@@ -35,6 +35,8 @@ typedef struct {
 host_driver_t *iwrap_driver(void);
 
 void iwrap_init(void);
+/* call in main loop: sends queued frames and runs connection state machine */
+void iwrap_task(void);
 void iwrap_send(const char *s);
 void iwrap_mux_send(const char *s);
 void iwrap_buf_send(void);
@@ -49,6 +51,7 @@ void iwrap_sniff(void);
 void iwrap_subrate(void);
 bool iwrap_failed(void);
 uint8_t iwrap_connected(void);
+/* requests LIST and returns last known state without waiting */
 uint8_t iwrap_check_connection(void);
 
 #endif
@@ -182,6 +182,7 @@ int main(void)
             usbPoll();
 
         keyboard_task();
+        iwrap_task();
 
        if (isUsbConnected)
             vusb_transfer_keyboard();
@@ -107,10 +107,17 @@ const USB_Descriptor_HIDReport_Datatype_t PROGMEM MouseReport[] =
             HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
             HID_RI_USAGE(8, 0x30), /* Usage X */
             HID_RI_USAGE(8, 0x31), /* Usage Y */
+#ifdef MOUSE_XY_16BIT
+            HID_RI_LOGICAL_MINIMUM(16, -32767),
+            HID_RI_LOGICAL_MAXIMUM(16, 32767),
+            HID_RI_REPORT_COUNT(8, 0x02),
+            HID_RI_REPORT_SIZE(8, 0x10),
+#else
             HID_RI_LOGICAL_MINIMUM(8, -127),
             HID_RI_LOGICAL_MAXIMUM(8, 127),
             HID_RI_REPORT_COUNT(8, 0x02),
             HID_RI_REPORT_SIZE(8, 0x08),
+#endif
             HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
 
             HID_RI_USAGE(8, 0x38), /* Wheel */
@@ -323,8 +330,14 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
             .TotalEndpoints         = 1,
 
             .Class                  = HID_CSCP_HIDClass,
+#ifdef MOUSE_XY_16BIT
+            /* report is not compatible with boot protocol */
+            .SubClass               = HID_CSCP_NonBootSubclass,
+            .Protocol               = HID_CSCP_NonBootProtocol,
+#else
             .SubClass               = HID_CSCP_BootSubclass,
             .Protocol               = HID_CSCP_MouseBootProtocol,
+#endif
 
             .InterfaceStrIndex      = NO_DESCRIPTOR
         },
@@ -36,6 +36,7 @@
   this software.
 */
 
+#include <util/atomic.h>
 #include "report.h"
 #include "host.h"
 #include "host_driver.h"
@@ -48,6 +49,8 @@
 #include "sleep_led.h"
 #endif
 #include "suspend.h"
+#include "latency.h"
+#include "trace.h"
 
 #include "descriptor.h"
 #include "lufa.h"
@@ -118,6 +121,16 @@ static void Console_Task(void)
         return;
     }
 
+#ifdef DEBUG_TRACE
+    // trace lines while they fit in bank
+    uint8_t line[TRACE_LINE_SIZE];
+    while (Endpoint_IsReadWriteAllowed() &&
+           CONSOLE_EPSIZE - Endpoint_BytesInEndpoint() >= TRACE_LINE_SIZE &&
+           trace_get_line(line)) {
+        Endpoint_Write_Stream_LE(line, TRACE_LINE_SIZE, NULL);
+    }
+#endif
+
     // fill empty bank
     while (Endpoint_IsReadWriteAllowed())
         Endpoint_Write_8(0);
@@ -353,109 +366,357 @@ static uint8_t keyboard_leds(void)
     return keyboard_led_stats;
 }
 
-static void send_keyboard(report_keyboard_t *report)
+/*
+ * Report queue
+ *
+ * Reports are never waited for. send_* puts a report into the queue of its
+ * endpoint and report_queue_task() writes queued reports out when the endpoint
+ * bank becomes free, so keyboard_task() doesn't stall for a polling interval.
+ * A report equal to the last queued one is redundant and coalesced; mouse
+ * motion with the same buttons is merged into the last one.
+ *
+ * Queued and pending reports are never replaced. When a queue is full the
+ * report is held in a pending slot and queued by report_queue_task() as soon
+ * as there is room. While pending is held host_send_busy() is true and
+ * keyboard_task() leaves key events in matrix, so only a burst of reports from
+ * one event can come on top; those go to a latest slot, which is queued after
+ * pending so the host ends on current state. Replaced latest reports are
+ * counted as dropped.
+ *
+ * clear_keyboard() is called from SetProtocol request, which runs in USB
+ * interrupt with INTERRUPT_CONTROL_ENDPOINT, so queue indexes are updated only
+ * with interrupts disabled. Endpoint is written with interrupts enabled;
+ * report_queue_task() nested in the interrupt leaves reports queued for main
+ * loop.
+ */
+#ifndef LUFA_REPORT_QUEUE_SIZE
+#   define LUFA_REPORT_QUEUE_SIZE 8
+#endif
+#if (LUFA_REPORT_QUEUE_SIZE & (LUFA_REPORT_QUEUE_SIZE - 1)) || LUFA_REPORT_QUEUE_SIZE > 128
+#   error "LUFA_REPORT_QUEUE_SIZE must be a power of 2 not larger than 128"
+#endif
+#define RQ_MASK         (LUFA_REPORT_QUEUE_SIZE - 1)
+#define RQ_COUNT(q)     ((uint8_t)((q).head - (q).tail))
+#define RQ_FULL(q)      (RQ_COUNT(q) == LUFA_REPORT_QUEUE_SIZE)
+#define RQ_LAST(q)      (((q).head - 1) & RQ_MASK)
+
+uint16_t lufa_report_dropped = 0;
+uint16_t lufa_report_coalesced = 0;
+
+static struct {
+    report_keyboard_t report[LUFA_REPORT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t tail;
+    bool has_pending;
+    report_keyboard_t pending;
+    bool has_latest;
+    report_keyboard_t latest;
+} keyboard_queue;
+
+#ifdef MOUSE_ENABLE
+static struct {
+    report_mouse_t report[LUFA_REPORT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t tail;
+    bool has_pending;
+    report_mouse_t pending;
+    bool has_latest;
+    report_mouse_t latest;
+} mouse_queue;
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+/* system and consumer share the endpoint; one pending slot for each */
+#define EXTRA_SYSTEM    0
+#define EXTRA_CONSUMER  1
+static struct {
+    report_extra_t report[LUFA_REPORT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t tail;
+    bool has_pending[2];
+    uint16_t pending[2];
+} extra_queue;
+#endif
+
+/* changed by report_queue_clear() to tell writer its report was cleared */
+static uint8_t queue_epoch = 0;
+static bool queue_writing = false;
+
+static void report_queue_clear(void)
 {
-    uint8_t timeout = 255;
+    queue_epoch++;
+    keyboard_queue.head = keyboard_queue.tail = 0;
+    keyboard_queue.has_pending = false;
+    keyboard_queue.has_latest = false;
+#ifdef MOUSE_ENABLE
+    mouse_queue.head = mouse_queue.tail = 0;
+    mouse_queue.has_pending = false;
+    mouse_queue.has_latest = false;
+#endif
+#ifdef EXTRAKEY_ENABLE
+    extra_queue.head = extra_queue.tail = 0;
+    extra_queue.has_pending[EXTRA_SYSTEM] = false;
+    extra_queue.has_pending[EXTRA_CONSUMER] = false;
+#endif
+}
 
-    if (USB_DeviceState != DEVICE_STATE_Configured)
-        return;
+/* writes report if endpoint bank is free, returns false otherwise */
+static bool report_write(uint8_t epnum, void *report, uint16_t size)
+{
+    Endpoint_SelectEndpoint(epnum);
+    if (!Endpoint_IsReadWriteAllowed()) return false;
+
+    Endpoint_Write_Stream_LE(report, size, NULL);
 
-    /* Select the Keyboard Report Endpoint */
+    /* Finalize the stream transfer to send the last packet */
+    Endpoint_ClearIN();
+    return true;
+}
+
+static bool keyboard_write(report_keyboard_t *report)
+{
 #ifdef NKRO_ENABLE
     if (keyboard_nkro) {
         /* Report protocol - NKRO */
-        Endpoint_SelectEndpoint(NKRO_IN_EPNUM);
-
-        /* Check if write ready for a polling interval around 1ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(4);
-        if (!Endpoint_IsReadWriteAllowed()) return;
-
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, NKRO_EPSIZE, NULL);
+        if (!report_write(NKRO_IN_EPNUM, report, NKRO_EPSIZE)) return false;
     }
     else
 #endif
     {
         /* Boot protocol */
-        Endpoint_SelectEndpoint(KEYBOARD_IN_EPNUM);
+        if (!report_write(KEYBOARD_IN_EPNUM, report, KEYBOARD_EPSIZE)) return false;
+    }
+    keyboard_report_sent = *report;
+    LATENCY_MARK(LATENCY_ENDPOINT);
+    return true;
+}
 
-        /* Check if write ready for a polling interval around 10ms */
-        while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-        if (!Endpoint_IsReadWriteAllowed()) return;
+#ifdef EXTRAKEY_ENABLE
+static void extra_enq(uint8_t report_id, uint16_t data)
+{
+    report_extra_t *r = &extra_queue.report[extra_queue.head++ & RQ_MASK];
+    r->report_id = report_id;
+    r->usage = data;
+}
+#endif
+
+/* advances tail after write unless queues were cleared meanwhile */
+#define RQ_WRITTEN(q, epoch)    do { \
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { \
+        if (queue_epoch == (epoch)) (q).tail++; \
+    } \
+} while (0)
 
-        /* Write Keyboard Report Data */
-        Endpoint_Write_Stream_LE(report, KEYBOARD_EPSIZE, NULL);
+static void report_queue_task(void)
+{
+    if (USB_DeviceState != DEVICE_STATE_Configured) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            report_queue_clear();
+        }
+        return;
     }
+    if (queue_writing) return;
+    queue_writing = true;
+    uint8_t epoch = queue_epoch;
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+    if (RQ_COUNT(keyboard_queue) &&
+            keyboard_write(&keyboard_queue.report[keyboard_queue.tail & RQ_MASK])) {
+        RQ_WRITTEN(keyboard_queue, epoch);
+    }
+#ifdef MOUSE_ENABLE
+    if (RQ_COUNT(mouse_queue) &&
+            report_write(MOUSE_IN_EPNUM, &mouse_queue.report[mouse_queue.tail & RQ_MASK],
+                         sizeof(report_mouse_t))) {
+        RQ_WRITTEN(mouse_queue, epoch);
+    }
+#endif
+#ifdef EXTRAKEY_ENABLE
+    if (RQ_COUNT(extra_queue) &&
+            report_write(EXTRAKEY_IN_EPNUM, &extra_queue.report[extra_queue.tail & RQ_MASK],
+                         sizeof(report_extra_t))) {
+        RQ_WRITTEN(extra_queue, epoch);
+    }
+#endif
 
-    keyboard_report_sent = *report;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (keyboard_queue.has_pending && !RQ_FULL(keyboard_queue)) {
+            keyboard_queue.report[keyboard_queue.head++ & RQ_MASK] = keyboard_queue.pending;
+            keyboard_queue.has_pending = keyboard_queue.has_latest;
+            keyboard_queue.pending = keyboard_queue.latest;
+            keyboard_queue.has_latest = false;
+        }
+#ifdef MOUSE_ENABLE
+        if (mouse_queue.has_pending && !RQ_FULL(mouse_queue)) {
+            mouse_queue.report[mouse_queue.head++ & RQ_MASK] = mouse_queue.pending;
+            mouse_queue.has_pending = mouse_queue.has_latest;
+            mouse_queue.pending = mouse_queue.latest;
+            mouse_queue.has_latest = false;
+        }
+#endif
+#ifdef EXTRAKEY_ENABLE
+        if (extra_queue.has_pending[EXTRA_SYSTEM] && !RQ_FULL(extra_queue)) {
+            extra_enq(REPORT_ID_SYSTEM, extra_queue.pending[EXTRA_SYSTEM]);
+            extra_queue.has_pending[EXTRA_SYSTEM] = false;
+        }
+        if (extra_queue.has_pending[EXTRA_CONSUMER] && !RQ_FULL(extra_queue)) {
+            extra_enq(REPORT_ID_CONSUMER, extra_queue.pending[EXTRA_CONSUMER]);
+            extra_queue.has_pending[EXTRA_CONSUMER] = false;
+        }
+#endif
+    }
+    queue_writing = false;
 }
 
-static void send_mouse(report_mouse_t *report)
+static void send_keyboard(report_keyboard_t *report)
 {
-#ifdef MOUSE_ENABLE
-    uint8_t timeout = 255;
-
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    /* Select the Mouse Report Endpoint */
-    Endpoint_SelectEndpoint(MOUSE_IN_EPNUM);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (keyboard_queue.has_pending) {
+            report_keyboard_t *last = (keyboard_queue.has_latest ?
+                                       &keyboard_queue.latest : &keyboard_queue.pending);
+            if (memcmp(last, report, sizeof(report_keyboard_t)) == 0) {
+                lufa_report_coalesced++;
+            } else {
+                if (keyboard_queue.has_latest) lufa_report_dropped++;
+                keyboard_queue.latest = *report;
+                keyboard_queue.has_latest = true;
+            }
+            return;
+        }
+        if (RQ_COUNT(keyboard_queue) &&
+                memcmp(&keyboard_queue.report[RQ_LAST(keyboard_queue)], report,
+                       sizeof(report_keyboard_t)) == 0) {
+            lufa_report_coalesced++;
+            return;
+        }
+        if (RQ_FULL(keyboard_queue)) {
+            keyboard_queue.pending = *report;
+            keyboard_queue.has_pending = true;
+            return;
+        }
+        keyboard_queue.report[keyboard_queue.head++ & RQ_MASK] = *report;
+    }
+    report_queue_task();
+}
 
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+#ifdef MOUSE_ENABLE
+/* merges motion of report into last if buttons are same and sum fits */
+static bool mouse_merge(report_mouse_t *last, report_mouse_t *report)
+{
+    if (last->buttons == report->buttons &&
+            (int32_t)last->x + report->x == (mouse_xy_t)((int32_t)last->x + report->x) &&
+            (int32_t)last->y + report->y == (mouse_xy_t)((int32_t)last->y + report->y) &&
+            last->v + report->v == (int8_t)(last->v + report->v) &&
+            last->h + report->h == (int8_t)(last->h + report->h)) {
+        last->x += report->x;
+        last->y += report->y;
+        last->v += report->v;
+        last->h += report->h;
+        return true;
+    }
+    return false;
+}
+#endif
 
-    /* Write Mouse Report Data */
-    Endpoint_Write_Stream_LE(report, sizeof(report_mouse_t), NULL);
+static void send_mouse(report_mouse_t *report)
+{
+#ifdef MOUSE_ENABLE
+    if (USB_DeviceState != DEVICE_STATE_Configured)
+        return;
 
-    /* Finalize the stream transfer to send the last packet */
-    Endpoint_ClearIN();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (mouse_queue.has_pending) {
+            report_mouse_t *last = (mouse_queue.has_latest ?
+                                    &mouse_queue.latest : &mouse_queue.pending);
+            if (mouse_merge(last, report)) {
+                lufa_report_coalesced++;
+            } else {
+                if (mouse_queue.has_latest) lufa_report_dropped++;
+                mouse_queue.latest = *report;
+                mouse_queue.has_latest = true;
+            }
+            return;
+        }
+        if (RQ_COUNT(mouse_queue) &&
+                mouse_merge(&mouse_queue.report[RQ_LAST(mouse_queue)], report)) {
+            lufa_report_coalesced++;
+            return;
+        }
+        if (RQ_FULL(mouse_queue)) {
+            mouse_queue.pending = *report;
+            mouse_queue.has_pending = true;
+            return;
+        }
+        mouse_queue.report[mouse_queue.head++ & RQ_MASK] = *report;
+    }
+    report_queue_task();
 #endif
 }
 
-static void send_system(uint16_t data)
+#ifdef EXTRAKEY_ENABLE
+static void send_extra(uint8_t report_id, uint16_t data)
 {
-    uint8_t timeout = 255;
-
     if (USB_DeviceState != DEVICE_STATE_Configured)
         return;
 
-    report_extra_t r = {
-        .report_id = REPORT_ID_SYSTEM,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+    uint8_t p = (report_id == REPORT_ID_SYSTEM ? EXTRA_SYSTEM : EXTRA_CONSUMER);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (extra_queue.has_pending[p]) {
+            if (extra_queue.pending[p] == data) {
+                lufa_report_coalesced++;
+            } else {
+                extra_queue.pending[p] = data;
+                lufa_report_dropped++;
+            }
+            return;
+        }
+        /* look for last queued one of same id */
+        for (uint8_t i = extra_queue.head; i != extra_queue.tail; ) {
+            report_extra_t *r = &extra_queue.report[--i & RQ_MASK];
+            if (r->report_id == report_id) {
+                if (r->usage == data) {
+                    lufa_report_coalesced++;
+                    return;
+                }
+                break;
+            }
+        }
+        if (RQ_FULL(extra_queue)) {
+            extra_queue.pending[p] = data;
+            extra_queue.has_pending[p] = true;
+            return;
+        }
+        extra_enq(report_id, data);
+    }
+    report_queue_task();
+}
+#endif
 
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+static void send_system(uint16_t data)
+{
+#ifdef EXTRAKEY_ENABLE
+    send_extra(REPORT_ID_SYSTEM, data);
+#endif
 }
 
 static void send_consumer(uint16_t data)
 {
-    uint8_t timeout = 255;
-
-    if (USB_DeviceState != DEVICE_STATE_Configured)
-        return;
-
-    report_extra_t r = {
-        .report_id = REPORT_ID_CONSUMER,
-        .usage = data
-    };
-    Endpoint_SelectEndpoint(EXTRAKEY_IN_EPNUM);
-
-    /* Check if write ready for a polling interval around 10ms */
-    while (timeout-- && !Endpoint_IsReadWriteAllowed()) _delay_us(40);
-    if (!Endpoint_IsReadWriteAllowed()) return;
+#ifdef EXTRAKEY_ENABLE
+    send_extra(REPORT_ID_CONSUMER, data);
+#endif
+}
 
-    Endpoint_Write_Stream_LE(&r, sizeof(report_extra_t), NULL);
-    Endpoint_ClearIN();
+/* no room to queue another report; keyboard_task() and macro player wait for this */
+bool host_send_busy(void)
+{
+    if (keyboard_queue.has_pending || RQ_FULL(keyboard_queue)) return true;
+#ifdef EXTRAKEY_ENABLE
+    if (extra_queue.has_pending[EXTRA_SYSTEM] || extra_queue.has_pending[EXTRA_CONSUMER] ||
+            RQ_FULL(extra_queue)) return true;
+#endif
+    return false;
 }
 
 
@@ -581,6 +842,7 @@ int main(void)
         }
 
         keyboard_task();
+        report_queue_task();
 
 #if !defined(INTERRUPT_CONTROL_ENDPOINT)
         USB_USBTask();
@@ -56,6 +56,10 @@ extern "C" {
 
 extern host_driver_t lufa_driver;
 
+/* report queue statistics */
+extern uint16_t lufa_report_dropped;
+extern uint16_t lufa_report_coalesced;
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,6 +38,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef PS2_H
 #define PS2_H
 
+#include <stdint.h>
 #include <stdbool.h>
 #include <util/delay.h>
 #include <avr/io.h>
@@ -75,8 +76,10 @@ POSSIBILITY OF SUCH DAMAGE.
 #define PS2_ERR_STARTBIT1   1
 #define PS2_ERR_STARTBIT2   2
 #define PS2_ERR_STARTBIT3   3
+#define PS2_ERR_NOACK       6
 #define PS2_ERR_PARITY      0x10
 #define PS2_ERR_NODATA      0x20
+#define PS2_ERR_TIMEOUT     0x40
 
 #define PS2_LED_SCROLL_LOCK 0
 #define PS2_LED_NUM_LOCK    1
@@ -91,6 +94,32 @@ uint8_t ps2_host_recv_response(void);
 uint8_t ps2_host_recv(void);
 void ps2_host_set_led(uint8_t usb_led);
 
+#ifdef PS2_USE_INT
+/*
+ * Asynchronous send(PS2_USE_INT only)
+ *
+ * Command is queued and sent by interrupt without waiting. func is called from
+ * ps2_host_task() with response of device; PS2_ACK, PS2_RESEND or 0 on error.
+ * With param, param is sent after Ack of cmd and response of param is passed.
+ * ps2_host_task() is also called in ps2_host_recv() and ps2_host_send().
+ * ps2_host_send() waits for queued commands and its own response.
+ */
+#ifndef PS2_TX_QUEUE_SIZE
+#define PS2_TX_QUEUE_SIZE   4
+#endif
+/* give up transmission and response after this time(ms) */
+#ifndef PS2_TX_TIMEOUT
+#define PS2_TX_TIMEOUT      40
+#endif
+typedef void (*ps2_response_func_t)(uint8_t cmd, uint8_t response);
+bool ps2_host_send_async(uint8_t data, ps2_response_func_t func);
+bool ps2_host_send_async_param(uint8_t cmd, uint8_t param, ps2_response_func_t func);
+bool ps2_host_busy(void);
+void ps2_host_task(void);
+#else
+#define ps2_host_task()
+#endif
+
 
 /* Check port settings for clock and data line */
 #if !(defined(PS2_CLOCK_PORT) && \
@@ -43,15 +43,13 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <avr/interrupt.h>
 #include <util/delay.h>
 #include "ps2.h"
+#include "timer.h"
 #include "print.h"
 
 
-#define WAIT(stat, us, err) do { \
-    if (!wait_##stat(us)) { \
-        ps2_error = err; \
-        goto ERROR; \
-    } \
-} while (0)
+#ifndef PS2_INT_CLEAR
+#   error "PS2_INT_CLEAR() is required in config.h"
+#endif
 
 
 uint8_t ps2_error = PS2_ERR_NONE;
@@ -63,6 +61,67 @@ static inline bool pbuf_has_data(void);
 static inline void pbuf_clear(void);
 
 
+/* receive state */
+enum {
+    RX_INIT,
+    RX_START,
+    RX_BIT0, RX_BIT1, RX_BIT2, RX_BIT3, RX_BIT4, RX_BIT5, RX_BIT6, RX_BIT7,
+    RX_PARITY,
+    RX_STOP,
+};
+static volatile uint8_t rx_state = RX_INIT;
+static uint8_t rx_data = 0;
+static uint8_t rx_parity = 1;
+
+/*
+ * Host to device transmission
+ *
+ * Bytes are queued by ps2_host_send_async() and clocked out bit by bit on
+ * falling edges of clock in the same ISR as receive. ps2_host_task() starts
+ * next transmission when line is idle, checks timeout and calls back with
+ * response from device in main loop. First byte received after a
+ * transmission is taken as response and isn't put into receive buffer.
+ */
+enum {
+    TX_IDLE,
+    TX_INHIBIT,         /* clock is held low for 100us */
+    TX_BIT0, TX_BIT1, TX_BIT2, TX_BIT3, TX_BIT4, TX_BIT5, TX_BIT6, TX_BIT7,
+    TX_PARITY,
+    TX_STOP,
+    TX_ACK,
+    TX_RESPONSE,        /* waiting for response byte */
+    TX_DONE,
+};
+static volatile uint8_t tx_state = TX_IDLE;
+static volatile uint8_t tx_data;
+static volatile uint8_t tx_parity;
+static volatile uint8_t tx_response;
+static uint16_t tx_time;
+static uint16_t tx_inhibit_us;
+static bool tx_wait = false;
+
+typedef struct {
+    uint8_t cmd;
+    uint8_t param;
+    bool has_param;
+    ps2_response_func_t func;
+} ps2_tx_t;
+
+#define TXQ_MASK    (PS2_TX_QUEUE_SIZE - 1)
+#if (PS2_TX_QUEUE_SIZE & TXQ_MASK)
+#   error "PS2_TX_QUEUE_SIZE must be power of 2"
+#endif
+static ps2_tx_t txq[PS2_TX_QUEUE_SIZE];
+static uint8_t txq_head = 0;
+static uint8_t txq_tail = 0;
+/* 0: sending cmd, 1: sending param */
+static uint8_t txq_phase = 0;
+
+/* LED state not queued yet for full queue, ps2_host_task() retries */
+static uint8_t led_state;
+static bool led_pending = false;
+
+
 void ps2_host_init(void)
 {
     idle();
@@ -72,60 +131,124 @@ void ps2_host_init(void)
     //_delay_ms(2500);
 }
 
-uint8_t ps2_host_send(uint8_t data)
+bool ps2_host_send_async(uint8_t data, ps2_response_func_t func)
 {
-    bool parity = true;
-    ps2_error = PS2_ERR_NONE;
-
-    PS2_INT_OFF();
+    if ((uint8_t)(txq_head - txq_tail) == PS2_TX_QUEUE_SIZE) return false;
+    txq[txq_head++ & TXQ_MASK] = (ps2_tx_t){ .cmd = data, .has_param = false, .func = func };
+    return true;
+}
 
-    /* terminate a transmission if we have */
-    inhibit();
-    _delay_us(100); // 100us [4]p.13, [5]p.50
+bool ps2_host_send_async_param(uint8_t cmd, uint8_t param, ps2_response_func_t func)
+{
+    if ((uint8_t)(txq_head - txq_tail) == PS2_TX_QUEUE_SIZE) return false;
+    txq[txq_head++ & TXQ_MASK] = (ps2_tx_t){ .cmd = cmd, .param = param, .has_param = true, .func = func };
+    return true;
+}
 
-    /* 'Request to Send' and Start bit */
-    data_lo();
-    clock_hi();
-    WAIT(clock_lo, 10000, 10);   // 10ms [5]p.50
+void ps2_host_task(void)
+{
+    if (led_pending && ps2_host_send_async_param(PS2_SET_LED, led_state, 0)) {
+        led_pending = false;
+    }
 
-    /* Data bit[2-9] */
-    for (uint8_t i = 0; i < 8; i++) {
-        _delay_us(15);
-        if (data&(1<<i)) {
-            parity = !parity;
-            data_hi();
-        } else {
+    switch (tx_state) {
+        case TX_IDLE:
+            if (txq_head == txq_tail) return;
+
+            PS2_INT_OFF();
+            if (rx_state != RX_INIT) {
+                // device is sending, wait for end of frame(about 1ms) unless it is stuck
+                if (!tx_wait) {
+                    tx_wait = true;
+                    tx_time = timer_read();
+                }
+                if (timer_elapsed(tx_time) < 3) {
+                    PS2_INT_ON();
+                    return;
+                }
+            }
+            tx_wait = false;
+            rx_state = RX_INIT;
+            rx_data = 0;
+            rx_parity = 1;
+
+            /* terminate a transmission if we have */
+            inhibit();
+            tx_inhibit_us = timer_read_us();
+            tx_time = timer_read();
+            tx_state = TX_INHIBIT;
+            return;
+        case TX_INHIBIT:
+            if ((uint16_t)((uint16_t)timer_read_us() - tx_inhibit_us) < 100) return; // 100us [4]p.13, [5]p.50
+            {
+                ps2_tx_t *tx = &txq[txq_tail & TXQ_MASK];
+                tx_data = txq_phase ? tx->param : tx->cmd;
+            }
+            tx_parity = 1;
+            tx_state = TX_BIT0;
+            /* 'Request to Send' and Start bit, device starts clocking in 10ms [5]p.50 */
             data_lo();
-        }
-        WAIT(clock_hi, 50, 2);
-        WAIT(clock_lo, 50, 3);
+            clock_hi();
+            /* drop falling edge of inhibit latched while interrupt was off */
+            PS2_INT_CLEAR();
+            PS2_INT_ON();
+            return;
+        case TX_DONE:
+            break;
+        default:
+            if (timer_elapsed(tx_time) <= PS2_TX_TIMEOUT) return;
+            {
+                uint8_t sreg = SREG;
+                cli();
+                if (tx_state != TX_DONE) {
+                    ps2_error = PS2_ERR_TIMEOUT;
+                    tx_response = 0;
+                    tx_state = TX_DONE;
+                    idle();
+                }
+                SREG = sreg;
+            }
+            break;
     }
 
-    /* Parity bit */
-    _delay_us(15);
-    if (parity) { data_hi(); } else { data_lo(); }
-    WAIT(clock_hi, 50, 4);
-    WAIT(clock_lo, 50, 5);
-
-    /* Stop bit */
-    _delay_us(15);
-    data_hi();
+    /* TX_DONE */
+    ps2_tx_t tx = txq[txq_tail & TXQ_MASK];
+    uint8_t response = tx_response;
+    tx_state = TX_IDLE;
+    if (response == PS2_ACK && tx.has_param && !txq_phase) {
+        // send param next
+        txq_phase = 1;
+        return;
+    }
+    txq_tail++;
+    txq_phase = 0;
+    if (tx.func) tx.func(tx.cmd, response);
+}
 
-    /* Ack */
-    WAIT(data_lo, 50, 6);
-    WAIT(clock_lo, 50, 7);
+bool ps2_host_busy(void)
+{
+    return tx_state != TX_IDLE || txq_head != txq_tail;
+}
 
-    /* wait for idle state */
-    WAIT(clock_hi, 50, 8);
-    WAIT(data_hi, 50, 9);
+static uint8_t sync_response;
+static bool sync_done;
+static void sync_callback(uint8_t cmd, uint8_t response)
+{
+    sync_response = response;
+    sync_done = true;
+}
 
-    idle();
-    PS2_INT_ON();
-    return ps2_host_recv_response();
-ERROR:
-    idle();
-    PS2_INT_ON();
-    return 0;
+uint8_t ps2_host_send(uint8_t data)
+{
+    ps2_error = PS2_ERR_NONE;
+    sync_done = false;
+    while (!ps2_host_send_async(data, sync_callback)) {
+        ps2_host_task();
+    }
+    while (!sync_done) {
+        ps2_host_task();
+    }
+    return sync_response;
 }
 
 uint8_t ps2_host_recv_response(void)
@@ -141,6 +264,7 @@ uint8_t ps2_host_recv_response(void)
 /* get data received by interrupt */
 uint8_t ps2_host_recv(void)
 {
+    ps2_host_task();
     if (pbuf_has_data()) {
         ps2_error = PS2_ERR_NONE;
         return pbuf_dequeue();
@@ -150,18 +274,47 @@ uint8_t ps2_host_recv(void)
     }
 }
 
-ISR(PS2_INT_VECT)
+/* put next bit of transmission on falling edge of clock */
+static inline void tx_clock(void)
 {
-    static enum {
-        INIT,
-        START,
-        BIT0, BIT1, BIT2, BIT3, BIT4, BIT5, BIT6, BIT7,
-        PARITY,
-        STOP,
-    } state = INIT;
-    static uint8_t data = 0;
-    static uint8_t parity = 1;
+    switch (tx_state) {
+        case TX_BIT0:
+        case TX_BIT1:
+        case TX_BIT2:
+        case TX_BIT3:
+        case TX_BIT4:
+        case TX_BIT5:
+        case TX_BIT6:
+        case TX_BIT7:
+            if (tx_data & 0x01) {
+                tx_parity++;
+                data_hi();
+            } else {
+                data_lo();
+            }
+            tx_data >>= 1;
+            break;
+        case TX_PARITY:
+            if (tx_parity & 0x01) { data_hi(); } else { data_lo(); }
+            break;
+        case TX_STOP:
+            data_hi();
+            break;
+        case TX_ACK:
+            if (data_in()) {
+                // no Ack
+                ps2_error = PS2_ERR_NOACK;
+                tx_response = 0;
+                tx_state = TX_DONE;
+                return;
+            }
+            break;
+    }
+    tx_state++;
+}
 
+ISR(PS2_INT_VECT)
+{
     // TODO: abort if elapse 100us from previous interrupt
 
     // return unless falling edge
@@ -169,39 +322,49 @@ ISR(PS2_INT_VECT)
         goto RETURN;
     }
 
-    state++;
-    switch (state) {
-        case START:
+    if (tx_state >= TX_BIT0 && tx_state <= TX_ACK) {
+        tx_clock();
+        goto RETURN;
+    }
+
+    rx_state++;
+    switch (rx_state) {
+        case RX_START:
             if (data_in())
                 goto ERROR;
             break;
-        case BIT0:
-        case BIT1:
-        case BIT2:
-        case BIT3:
-        case BIT4:
-        case BIT5:
-        case BIT6:
-        case BIT7:
-            data >>= 1;
+        case RX_BIT0:
+        case RX_BIT1:
+        case RX_BIT2:
+        case RX_BIT3:
+        case RX_BIT4:
+        case RX_BIT5:
+        case RX_BIT6:
+        case RX_BIT7:
+            rx_data >>= 1;
             if (data_in()) {
-                data |= 0x80;
-                parity++;
+                rx_data |= 0x80;
+                rx_parity++;
             }
             break;
-        case PARITY:
+        case RX_PARITY:
             if (data_in()) {
-                if (!(parity & 0x01))
+                if (!(rx_parity & 0x01))
                     goto ERROR;
             } else {
-                if (parity & 0x01)
+                if (rx_parity & 0x01)
                     goto ERROR;
             }
             break;
-        case STOP:
+        case RX_STOP:
             if (!data_in())
                 goto ERROR;
-            pbuf_enqueue(data);
+            if (tx_state == TX_RESPONSE) {
+                tx_response = rx_data;
+                tx_state = TX_DONE;
+            } else {
+                pbuf_enqueue(rx_data);
+            }
             goto DONE;
             break;
         default:
@@ -209,20 +372,20 @@ ISR(PS2_INT_VECT)
     }
     goto RETURN;
 ERROR:
-    ps2_error = state;
+    ps2_error = rx_state;
 DONE:
-    state = INIT;
-    data = 0;
-    parity = 1;
+    rx_state = RX_INIT;
+    rx_data = 0;
+    rx_parity = 1;
 RETURN:
     return;
 }
 
-/* send LED state to keyboard */
+/* send LED state to keyboard without waiting, latest state is kept if queue is full */
 void ps2_host_set_led(uint8_t led)
 {
-    ps2_host_send(0xED);
-    ps2_host_send(led);
+    led_state = led;
+    led_pending = !ps2_host_send_async_param(PS2_SET_LED, led, 0);
 }
 
 
@@ -21,16 +21,45 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ps2.h"
 #include "ps2_mouse.h"
 #include "report.h"
+#include "mouse_motion.h"
 #include "host.h"
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "defer.h"
 
 
+/* last report sent to host */
 static report_mouse_t mouse_report = {};
+/* motion not sent yet */
+static mouse_motion_t motion = {};
+
+#ifdef PS2_MOUSE_PACKET_RECV
+/* packet being assembled from received bytes */
+static uint8_t packet[4];
+static uint8_t packet_len = 0;
+static uint8_t packet_size = 3;
+static uint16_t packet_time = 0;
+#endif
+
+#if defined(PS2_MOUSE_PACKET_RECV) && !defined(PS2_MOUSE_STREAM_MODE)
+/* Read Data is sent and its packet is not received yet */
+static bool read_pending = false;
+static uint16_t read_time = 0;
+#endif
+
+#if PS2_MOUSE_SCROLL_BTN_MASK && PS2_MOUSE_SCROLL_BTN_SEND
+/* Scroll Button being clicked, held in reports until release is fired */
+static uint8_t scroll_click = 0;
+#endif
 
 
+#ifdef PS2_MOUSE_DEBUG
 static void print_usb_data(void);
+#else
+#define print_usb_data()
+#endif
+static void process_mouse_report(uint8_t status, uint8_t x_data, uint8_t y_data, int8_t z);
 
 
 /* supports only 3 button mouse at this time */
@@ -39,15 +68,19 @@ uint8_t ps2_mouse_init(void) {
 
     ps2_host_init();
 
-    _delay_ms(1000);    // wait for powering up
-
-    // send Reset
-    rcv = ps2_host_send(0xFF);
+    // send Reset; mouse doesn't answer until it powers up
+    uint16_t init_time = timer_read();
+    do {
+        rcv = ps2_host_send(0xFF);
+    } while (rcv != PS2_ACK && timer_elapsed(init_time) < PS2_MOUSE_INIT_TIMEOUT);
     print("ps2_mouse_init: send Reset: ");
     phex(rcv); phex(ps2_error); print("\n");
 
-    // read completion code of BAT
-    rcv = ps2_host_recv_response();
+    // read completion code of BAT, self test takes 300-500ms
+    init_time = timer_read();
+    do {
+        rcv = ps2_host_recv_response();
+    } while (rcv != 0xAA && timer_elapsed(init_time) < PS2_MOUSE_INIT_TIMEOUT);
     print("ps2_mouse_init: read BAT: ");
     phex(rcv); phex(ps2_error); print("\n");
 
@@ -56,135 +89,238 @@ uint8_t ps2_mouse_init(void) {
     print("ps2_mouse_init: read DevID: ");
     phex(rcv); phex(ps2_error); print("\n");
 
+#ifdef PS2_MOUSE_STREAM_MODE
+    // IntelliMouse wheel: set sample rate 200, 100, 80 and read ID again
+    packet_size = 3;
+    ps2_host_send(PS2_MOUSE_SET_SAMPLE_RATE); ps2_host_send(200);
+    ps2_host_send(PS2_MOUSE_SET_SAMPLE_RATE); ps2_host_send(100);
+    ps2_host_send(PS2_MOUSE_SET_SAMPLE_RATE); ps2_host_send(80);
+    rcv = ps2_host_send(PS2_MOUSE_GET_DEVICE_ID);
+    if (rcv == PS2_ACK) {
+        rcv = ps2_host_recv_response();
+        if (rcv == 3) packet_size = 4;
+    }
+    print("ps2_mouse_init: IntelliMouse ID: ");
+    phex(rcv); phex(ps2_error); print("\n");
+
+    // restore sample rate and start streaming; packets come by interrupt
+    ps2_host_send(PS2_MOUSE_SET_SAMPLE_RATE); ps2_host_send(100);
+    rcv = ps2_host_send(PS2_MOUSE_ENABLE_DATA_REPORTING);
+    print("ps2_mouse_init: send 0xF4: ");
+    phex(rcv); phex(ps2_error); print("\n");
+    packet_len = 0;
+#else
     // send Set Remote mode
     rcv = ps2_host_send(0xF0);
     print("ps2_mouse_init: send 0xF0: ");
     phex(rcv); phex(ps2_error); print("\n");
+#endif
 
     return 0;
 }
 
-#define X_IS_NEG  (mouse_report.buttons & (1<<PS2_MOUSE_X_SIGN))
-#define Y_IS_NEG  (mouse_report.buttons & (1<<PS2_MOUSE_Y_SIGN))
-#define X_IS_OVF  (mouse_report.buttons & (1<<PS2_MOUSE_X_OVFLW))
-#define Y_IS_OVF  (mouse_report.buttons & (1<<PS2_MOUSE_Y_OVFLW))
+#ifdef PS2_MOUSE_PACKET_RECV
+/*
+ * Assemble packet from byte stream. Returns true when a packet is completed.
+ * First byte always has bit3 set; a byte without it or a gap longer than
+ * PS2_MOUSE_PACKET_TIMEOUT starts over to resync with packet boundary.
+ */
+static bool packet_recv(uint8_t data)
+{
+    if (packet_len && TIMER_DIFF_16(timer_read(), packet_time) > PS2_MOUSE_PACKET_TIMEOUT) {
+        if (debug_mouse) print("ps2_mouse: packet timeout\n");
+        packet_len = 0;
+    }
+    if (packet_len == 0 && !(data & (1<<PS2_MOUSE_ALWAYS_1))) {
+        if (debug_mouse) { print("ps2_mouse: out of sync: "); phex(data); print("\n"); }
+        return false;
+    }
+    packet_time = timer_read();
+    packet[packet_len++] = data;
+    if (packet_len < packet_size) return false;
+    packet_len = 0;
+    return true;
+}
+#endif
+
+#define X_IS_NEG  (status & (1<<PS2_MOUSE_X_SIGN))
+#define Y_IS_NEG  (status & (1<<PS2_MOUSE_Y_SIGN))
+#define X_IS_OVF  (status & (1<<PS2_MOUSE_X_OVFLW))
+#define Y_IS_OVF  (status & (1<<PS2_MOUSE_Y_OVFLW))
+#if defined(PS2_MOUSE_PACKET_RECV) && !defined(PS2_MOUSE_STREAM_MODE)
+static void read_data_response(uint8_t cmd, uint8_t response)
+{
+    if (response != PS2_ACK) {
+        if (debug_mouse) print("ps2_mouse: fail to get mouse packet\n");
+        read_pending = false;
+    }
+}
+#endif
+
 void ps2_mouse_task(void)
 {
-    enum { SCROLL_NONE, SCROLL_BTN, SCROLL_SENT };
-    static uint8_t scroll_state = SCROLL_NONE;
-    static uint8_t buttons_prev = 0;
+#ifdef PS2_MOUSE_PACKET_RECV
+#ifndef PS2_MOUSE_STREAM_MODE
+    /* remote mode: request next packet without waiting, give up lost one */
+    if (read_pending &&
+            TIMER_DIFF_16(timer_read(), read_time) > PS2_TX_TIMEOUT + PS2_MOUSE_PACKET_TIMEOUT) {
+        read_pending = false;
+    }
+    if (!read_pending && ps2_host_send_async(PS2_MOUSE_READ_DATA, read_data_response)) {
+        read_pending = true;
+        read_time = timer_read();
+    }
+#endif
 
+    /* consume bytes received by interrupt, never waits */
+    while (1) {
+        uint8_t data = ps2_host_recv();
+        if (ps2_error == PS2_ERR_NODATA) break;
+        if (!packet_recv(data)) continue;
+
+        // IntelliMouse Z movement, positive is wheel down
+        process_mouse_report(packet[0], packet[1], packet[2],
+                             (packet_size == 4) ? -(int8_t)packet[3] : 0);
+#ifndef PS2_MOUSE_STREAM_MODE
+        read_pending = false;
+#endif
+    }
+#else
     /* receives packet from mouse */
     uint8_t rcv;
     rcv = ps2_host_send(PS2_MOUSE_READ_DATA);
     if (rcv == PS2_ACK) {
-        mouse_report.buttons = ps2_host_recv_response();
-        mouse_report.x = ps2_host_recv_response();
-        mouse_report.y = ps2_host_recv_response();
+        uint8_t status = ps2_host_recv_response();
+        uint8_t x = ps2_host_recv_response();
+        uint8_t y = ps2_host_recv_response();
+        process_mouse_report(status, x, y, 0);
     } else {
         if (debug_mouse) print("ps2_mouse: fail to get mouse packet\n");
-        return;
     }
-        xprintf("%ud ", timer_read());
-        print("ps2_mouse raw: [");
-        phex(mouse_report.buttons); print("|");
-        print_hex8((uint8_t)mouse_report.x); print(" ");
-        print_hex8((uint8_t)mouse_report.y); print("]\n");
+#endif
+
+    /* send rest of motion which didn't fit in previous report */
+    if (motion_pending(&motion)) {
+        motion_take(&motion, &mouse_report);
+        host_mouse_send(&mouse_report);
+        print_usb_data();
+    }
+}
+
+#if PS2_MOUSE_SCROLL_BTN_MASK && PS2_MOUSE_SCROLL_BTN_SEND
+static void scroll_click_release(uint8_t arg)
+{
+    (void)arg;
+    scroll_click = 0;
+    mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+    mouse_report.x = mouse_report.y = mouse_report.v = mouse_report.h = 0;
+    host_mouse_send(&mouse_report);
+    print_usb_data();
+}
+#endif
+
+static void process_mouse_report(uint8_t status, uint8_t x_data, uint8_t y_data, int8_t z)
+{
+    enum { SCROLL_NONE, SCROLL_BTN, SCROLL_SENT };
+    static uint8_t scroll_state = SCROLL_NONE;
+    static uint8_t buttons_prev = 0;
+    uint8_t buttons = status & PS2_MOUSE_BTN_MASK;
+
+    // PS/2 mouse data is '9-bit integer'(-256 to 255) which is comprised of sign-bit and 8-bit value.
+    // bit: 8    7 ... 0
+    //      sign \8-bit/
+    //
+    // USB HID mouse indicates 8bit data(-127 to 127) or 16bit with MOUSE_XY_16BIT.
+    // Whole 9-bit value is accumulated and what exceeds report range is sent
+    // in following reports instead of being clamped. Overflow is taken as limit.
+    int16_t x = X_IS_NEG ? (X_IS_OVF ? -256 : (int16_t)x_data - 256) : (X_IS_OVF ? 255 : x_data);
+    int16_t y = Y_IS_NEG ? (Y_IS_OVF ? -256 : (int16_t)y_data - 256) : (Y_IS_OVF ? 255 : y_data);
 
     /* if mouse moves or buttons state changes */
-    if (mouse_report.x || mouse_report.y ||
-            ((mouse_report.buttons ^ buttons_prev) & PS2_MOUSE_BTN_MASK)) {
+    if (!(x || y || z || (buttons ^ buttons_prev))) return;
 
 #ifdef PS2_MOUSE_DEBUG
+    if (debug_mouse) {
         print("ps2_mouse raw: [");
-        phex(mouse_report.buttons); print("|");
-        print_hex8((uint8_t)mouse_report.x); print(" ");
-        print_hex8((uint8_t)mouse_report.y); print("]\n");
+        phex(status); print("|");
+        print_hex8(x_data); print(" ");
+        print_hex8(y_data); print("]\n");
+    }
 #endif
 
-        buttons_prev = mouse_report.buttons;
-
-        // PS/2 mouse data is '9-bit integer'(-256 to 255) which is comprised of sign-bit and 8-bit value.
-        // bit: 8    7 ... 0
-        //      sign \8-bit/
-        //
-        // Meanwhile USB HID mouse indicates 8bit data(-127 to 127), note that -128 is not used.
-        //
-        // This converts PS/2 data into HID value. Use only -127-127 out of PS/2 9-bit.
-        mouse_report.x = X_IS_NEG ?
-                          ((!X_IS_OVF && -127 <= mouse_report.x && mouse_report.x <= -1) ?  mouse_report.x : -127) :
-                          ((!X_IS_OVF && 0 <= mouse_report.x && mouse_report.x <= 127) ? mouse_report.x : 127);
-        mouse_report.y = Y_IS_NEG ?
-                          ((!Y_IS_OVF && -127 <= mouse_report.y && mouse_report.y <= -1) ?  mouse_report.y : -127) :
-                          ((!Y_IS_OVF && 0 <= mouse_report.y && mouse_report.y <= 127) ? mouse_report.y : 127);
-
-        // remove sign and overflow flags
-        mouse_report.buttons &= PS2_MOUSE_BTN_MASK;
+    buttons_prev = buttons;
 
-        // invert coordinate of y to conform to USB HID mouse
-        mouse_report.y = -mouse_report.y;
+    // invert coordinate of y to conform to USB HID mouse
+    y = -y;
 
+    int32_t dx = MOTION(x);
+    int32_t dy = MOTION(y);
+    int32_t dv = MOTION(z);
+    int32_t dh = 0;
 
 #if PS2_MOUSE_SCROLL_BTN_MASK
-        static uint16_t scroll_button_time = 0;
-        if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == (PS2_MOUSE_SCROLL_BTN_MASK)) {
-            if (scroll_state == SCROLL_NONE) {
-                scroll_button_time = timer_read();
-                scroll_state = SCROLL_BTN;
-            }
-
-            // doesn't send Scroll Button
-            //mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+    static uint16_t scroll_button_time = 0;
+    if ((buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == (PS2_MOUSE_SCROLL_BTN_MASK)) {
+        if (scroll_state == SCROLL_NONE) {
+            scroll_button_time = timer_read();
+            scroll_state = SCROLL_BTN;
+        }
 
-            if (mouse_report.x || mouse_report.y) {
-                scroll_state = SCROLL_SENT;
+        if (x || y) {
+            scroll_state = SCROLL_SENT;
 
-                mouse_report.v = -mouse_report.y/(PS2_MOUSE_SCROLL_DIVISOR_V);
-                mouse_report.h =  mouse_report.x/(PS2_MOUSE_SCROLL_DIVISOR_H);
-                mouse_report.x = 0;
-                mouse_report.y = 0;
-                //host_mouse_send(&mouse_report);
-            }
+            // fraction of divided motion is carried over to next packet
+            dv += -dy/(PS2_MOUSE_SCROLL_DIVISOR_V);
+            dh +=  dx/(PS2_MOUSE_SCROLL_DIVISOR_H);
+            dx = 0;
+            dy = 0;
         }
-        else if ((mouse_report.buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == 0) {
+    }
+    else if ((buttons & (PS2_MOUSE_SCROLL_BTN_MASK)) == 0) {
 #if PS2_MOUSE_SCROLL_BTN_SEND
-            if (scroll_state == SCROLL_BTN &&
-                    TIMER_DIFF_16(timer_read(), scroll_button_time) < PS2_MOUSE_SCROLL_BTN_SEND) {
-                // send Scroll Button(down and up at once) when not scrolled
-                mouse_report.buttons |= (PS2_MOUSE_SCROLL_BTN_MASK);
-                host_mouse_send(&mouse_report);
-                _delay_ms(100);
-                mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+        if (scroll_state == SCROLL_BTN &&
+                TIMER_DIFF_16(timer_read(), scroll_button_time) < PS2_MOUSE_SCROLL_BTN_SEND) {
+            // send Scroll Button when not scrolled, release is sent later from main loop
+            if (!scroll_click && defer_exec(PS2_MOUSE_SCROLL_BTN_HOLD, scroll_click_release, 0)) {
+                scroll_click = (PS2_MOUSE_SCROLL_BTN_MASK);
             }
-#endif
-            scroll_state = SCROLL_NONE;
         }
-        // doesn't send Scroll Button
-        mouse_report.buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+#endif
+        scroll_state = SCROLL_NONE;
+    }
+    // doesn't send Scroll Button
+    buttons &= ~(PS2_MOUSE_SCROLL_BTN_MASK);
+#if PS2_MOUSE_SCROLL_BTN_SEND
+    buttons |= scroll_click;
+#endif
 #endif
 
-
+    motion_add(&motion, dx, dy, dv, dh);
+    bool moved = motion_take(&motion, &mouse_report);
+    if (moved || buttons != mouse_report.buttons) {
+        mouse_report.buttons = buttons;
         host_mouse_send(&mouse_report);
         print_usb_data();
     }
-    // clear report
-    mouse_report.x = 0;
-    mouse_report.y = 0;
-    mouse_report.v = 0;
-    mouse_report.h = 0;
-    mouse_report.buttons = 0;
 }
 
+#ifdef PS2_MOUSE_DEBUG
 static void print_usb_data(void)
 {
     if (!debug_mouse) return;
     print("ps2_mouse usb: [");
     phex(mouse_report.buttons); print("|");
+#ifdef MOUSE_XY_16BIT
+    print_hex16((uint16_t)mouse_report.x); print(" ");
+    print_hex16((uint16_t)mouse_report.y); print(" ");
+#else
     print_hex8((uint8_t)mouse_report.x); print(" ");
     print_hex8((uint8_t)mouse_report.y); print(" ");
+#endif
     print_hex8((uint8_t)mouse_report.v); print(" ");
     print_hex8((uint8_t)mouse_report.h); print("]\n");
 }
+#endif
 
 
 /* PS/2 Mouse Synopsis
@@ -209,7 +345,11 @@ static void print_usb_data(void)
  * Stream Mode: devices sends the data when it changs its state
  * Remote Mode: host polls the data periodically
  *
- * This code uses Remote Mode and polls the data with Read Data(0xEB).
+ * This code uses Remote Mode and polls the data with Read Data(0xEB) by default.
+ * With PS2_USE_INT Read Data is sent without waiting and packet is assembled
+ * from received bytes like Stream Mode.
+ * With PS2_MOUSE_STREAM_MODE it enables Stream Mode and assembles packets from
+ * bytes received by interrupt(PS2_USE_INT or PS2_USE_USART).
  *
  * Data format:
  * byte|7       6       5       4       3       2       1       0
@@ -217,4 +357,5 @@ static void print_usb_data(void)
  *    0|Yovflw  Xovflw  Ysign   Xsign   1       Middle  Right   Left
  *    1|                    X movement
  *    2|                    Y movement
+ *    3|                    Z movement(IntelliMouse wheel, device ID 3)
  */
@@ -21,6 +21,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdbool.h>
 
 #define PS2_MOUSE_READ_DATA     0xEB
+#define PS2_MOUSE_ENABLE_DATA_REPORTING 0xF4
+#define PS2_MOUSE_SET_SAMPLE_RATE       0xF3
+#define PS2_MOUSE_GET_DEVICE_ID         0xF2
 
 /*
  * Data format:
@@ -34,11 +37,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS2_MOUSE_BTN_LEFT      0
 #define PS2_MOUSE_BTN_RIGHT     1
 #define PS2_MOUSE_BTN_MIDDLE    2
+#define PS2_MOUSE_ALWAYS_1      3
 #define PS2_MOUSE_X_SIGN        4
 #define PS2_MOUSE_Y_SIGN        5
 #define PS2_MOUSE_X_OVFLW       6
 #define PS2_MOUSE_Y_OVFLW       7
 
+/* longest time(ms) to wait for mouse to answer Reset after power-up, and then to finish self test */
+#ifndef PS2_MOUSE_INIT_TIMEOUT
+#define PS2_MOUSE_INIT_TIMEOUT  1000
+#endif
+
 
 /*
  * Scroll by mouse move with pressing button
@@ -51,6 +60,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef PS2_MOUSE_SCROLL_BTN_SEND
 #define PS2_MOUSE_SCROLL_BTN_SEND       300
 #endif
+/* how long sent button is held(ms) before release */
+#ifndef PS2_MOUSE_SCROLL_BTN_HOLD
+#define PS2_MOUSE_SCROLL_BTN_HOLD       100
+#endif
 /* divide virtical and horizontal mouse move by this to convert to scroll move */
 #ifndef PS2_MOUSE_SCROLL_DIVISOR_V
 #define PS2_MOUSE_SCROLL_DIVISOR_V      2
@@ -60,6 +73,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 
+/*
+ * Stream mode: mouse sends packets by itself and they are received by interrupt.
+ * Define PS2_MOUSE_STREAM_MODE in config.h to use it instead of polling in remote mode.
+ */
+#ifdef PS2_MOUSE_STREAM_MODE
+#   ifdef PS2_USE_BUSYWAIT
+#       error "PS2_MOUSE_STREAM_MODE requires PS2_USE_INT or PS2_USE_USART"
+#   endif
+#endif
+
+/*
+ * Packet is assembled from bytes received by interrupt in stream mode and also
+ * in remote mode with PS2_USE_INT, where Read Data is sent without waiting.
+ */
+#if defined(PS2_MOUSE_STREAM_MODE) || defined(PS2_USE_INT)
+#   define PS2_MOUSE_PACKET_RECV
+/* start over packet when next byte doesn't come in this time(ms) */
+#   ifndef PS2_MOUSE_PACKET_TIMEOUT
+#       define PS2_MOUSE_PACKET_TIMEOUT 20
+#   endif
+#endif
+
+/*
+ * Per-packet debug print of raw data and report is compiled in only when
+ * PS2_MOUSE_DEBUG is defined in config.h, and shown while debug_mouse is on.
+ */
+
+
 uint8_t ps2_mouse_init(void);
 void ps2_mouse_task(void);
 
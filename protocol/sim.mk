@@ -0,0 +1,53 @@
+#
+# Host simulation build
+#   Builds common with keymap for host running keyboard_task() on virtual clock.
+#   Include after common.mk instead of rules.mk:
+#       include $(TOP_DIR)/common.mk
+#       include $(TOP_DIR)/protocol/sim.mk
+#
+SIM_DIR = protocol/sim
+
+# AVR dependent modules are replaced by simulation
+SRC := $(filter-out $(COMMON_DIR)/timer.c \
+                    $(COMMON_DIR)/bootloader.c \
+                    $(COMMON_DIR)/suspend.c \
+                    $(COMMON_DIR)/sleep_led.c \
+                    $(COMMON_DIR)/backlight.c \
+                    $(COMMON_DIR)/xprintf.S, $(SRC))
+
+SRC += $(SIM_DIR)/main.c \
+       $(SIM_DIR)/timer.c \
+       $(SIM_DIR)/eeprom.c \
+       $(SIM_DIR)/matrix.c
+
+OPT_DEFS += -DPROTOCOL_SIM
+
+# Search Path
+VPATH += $(TOP_DIR)/$(SIM_DIR)
+
+
+SIM_CC ?= cc
+SIM_OBJDIR = obj_$(TARGET)
+SIM_CFLAGS = -std=c99 -O2 -fcommon -Wall -Wno-unused-function
+SIM_CFLAGS += -DF_CPU=16000000UL $(OPT_DEFS)
+SIM_CFLAGS += -I$(TOP_DIR)/$(SIM_DIR) -I$(TARGET_DIR) -I$(TOP_DIR) -I$(TOP_DIR)/common
+ifdef CONFIG_H
+    SIM_CFLAGS += -include $(CONFIG_H)
+endif
+
+SIM_OBJ = $(addprefix $(SIM_OBJDIR)/,$(SRC:.c=.o))
+
+
+all: $(TARGET)
+
+$(TARGET): $(SIM_OBJ)
+	$(SIM_CC) -o $@ $^
+
+$(SIM_OBJDIR)/%.o: %.c
+	@mkdir -p $(dir $@)
+	$(SIM_CC) -c $(SIM_CFLAGS) $< -o $@
+
+clean:
+	rm -rf $(SIM_OBJDIR) $(TARGET)
+
+.PHONY: all clean
@@ -0,0 +1,39 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* avr-libc replacement for host simulation: see eeprom.c */
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define E2END   1023
+
+uint8_t eeprom_read_byte(const uint8_t *p);
+uint16_t eeprom_read_word(const uint16_t *p);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_byte(uint8_t *p, uint8_t value);
+void eeprom_write_word(uint16_t *p, uint16_t value);
+void eeprom_write_block(const void *src, void *dst, size_t n);
+bool eeprom_is_ready(void);
+void eeprom_busy_wait(void);
+
+#define eeprom_update_byte(p, v)    eeprom_write_byte(p, v)
+#define eeprom_update_word(p, v)    eeprom_write_word(p, v)
+
+#endif
@@ -0,0 +1,120 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * EEPROM model: blank(0xFF) at start, each byte write takes SIM_EEPROM_WRITE_US
+ * of virtual time in background like AVR. Access while write is in progress
+ * waits for it and the wait is counted as blocking time. Writes are counted
+ * per cell for wear.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include "timer.h"
+#include "sim.h"
+
+
+/* erase and write time of ATmega32U4 */
+#ifndef SIM_EEPROM_WRITE_US
+#define SIM_EEPROM_WRITE_US 3400
+#endif
+
+static uint8_t eeprom[E2END + 1];
+static uint32_t wear[E2END + 1];
+static bool initialized = false;
+static uint32_t busy_until = 0;
+static uint32_t writes = 0;
+static uint64_t blocked_us = 0;
+
+
+static void init(void)
+{
+    if (initialized) return;
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    initialized = true;
+}
+
+bool eeprom_is_ready(void)
+{
+    return timer_read_us() >= busy_until;
+}
+
+void eeprom_busy_wait(void)
+{
+    uint32_t now = timer_read_us();
+    if (now < busy_until) {
+        blocked_us += busy_until - now;
+        sim_timer_advance_us(busy_until - now);
+    }
+}
+
+uint8_t eeprom_read_byte(const uint8_t *p)
+{
+    init();
+    eeprom_busy_wait();
+    return eeprom[(uintptr_t)p & E2END];
+}
+
+uint16_t eeprom_read_word(const uint16_t *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    return eeprom_read_byte(b) | eeprom_read_byte(b + 1)<<8;
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+void eeprom_write_byte(uint8_t *p, uint8_t value)
+{
+    init();
+    eeprom_busy_wait();
+    uintptr_t addr = (uintptr_t)p & E2END;
+    eeprom[addr] = value;
+    wear[addr]++;
+    writes++;
+    busy_until = timer_read_us() + SIM_EEPROM_WRITE_US;
+}
+
+void eeprom_write_word(uint16_t *p, uint16_t value)
+{
+    uint8_t *b = (uint8_t *)p;
+    eeprom_write_byte(b, value & 0xFF);
+    eeprom_write_byte(b + 1, value>>8);
+}
+
+void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
+
+void sim_eeprom_stats(uint32_t *total, uint32_t *max_wear, uint32_t *blocked_ms)
+{
+    uint32_t max = 0;
+    for (uint16_t i = 0; i <= E2END; i++) {
+        if (wear[i] > max) max = wear[i];
+    }
+    *total = writes;
+    *max_wear = max;
+    *blocked_ms = blocked_us / 1000;
+}
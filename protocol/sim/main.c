@@ -0,0 +1,379 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Host simulation
+ *
+ * Runs keyboard_task() on virtual clock with scriptable matrix and records
+ * reports sent to host. Key trace is read from stdin, one event per line:
+ *
+ *     <time(ms)> <row> <col> <d|u>         # comment
+ *
+ * Reports are printed on stdout with time of virtual clock:
+ *
+ *     <time> keyboard <raw report bytes>
+ *     <time> mouse <buttons> <x> <y> <v> <h>
+ *     <time> system <usage>
+ *     <time> consumer <usage>
+ *
+ * Summary of event-to-report latency and throughput is printed on stderr,
+ * with per stage percentiles when built with LATENCY_TRACE_ENABLE and
+ * startup timeline when built with STARTUP_TRACE_ENABLE. EEPROM writes are
+ * modeled with AVR write time and counted per cell. With SIM_DEBOUNCE the
+ * matrix goes through common/debounce.c.
+ *
+ * Latency of a key press is time until first report which carries the key:
+ * keyboard report with its keycode or modifiers, or mouse, system or consumer
+ * report for those keys, as the key resolves on layers at time of report.
+ * Releases, which may be reported early by layer change, tap keys, which are
+ * reported on release by design, and keys without report of their own like
+ * layer switch are not counted. "delayed" shows number and median latency of
+ * presses reported later than the scan they were seen, "unreported" presses
+ * which never showed up in a report before next press of the key.
+ *
+ * With DEBUG_TRACE_ENABLE trace lines are drained to stdout at one line per
+ * millisecond like LUFA console at start of frame; pipe to tool/trace_decode.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "keyboard.h"
+#include "action.h"
+#include "action_layer.h"
+#include "host.h"
+#include "host_driver.h"
+#include "timer.h"
+#include "led.h"
+#include "latency.h"
+#include "startup_trace.h"
+#include "trace.h"
+#include "bootloader.h"
+#include "sim.h"
+
+
+/* time to keep running after last event to let tapping and timers settle */
+#ifndef SIM_SETTLE_TIME
+#define SIM_SETTLE_TIME 1000
+#endif
+
+/* keyboard_task() calls per virtual millisecond */
+#ifndef SIM_TASKS_PER_MS
+#define SIM_TASKS_PER_MS 1
+#endif
+
+
+typedef struct {
+    uint32_t time;
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+    bool     tap_key;
+} sim_event_t;
+
+static sim_event_t *events = NULL;
+static size_t events_len = 0;
+
+static size_t events_next = 0;
+
+static bool quiet = false;
+static uint32_t report_count = 0;
+/* key presses applied and not reported yet, index into events */
+static size_t *pending = NULL;
+static size_t pending_len = 0;
+static size_t unreported = 0;
+static uint32_t *latencies = NULL;
+static size_t latency_count = 0;
+static uint64_t latency_sum = 0;
+
+enum report_type {
+    REPORT_KEYBOARD,
+    REPORT_MOUSE,
+    REPORT_SYSTEM,
+    REPORT_CONSUMER,
+};
+
+
+static bool report_has_code(report_keyboard_t *report, uint8_t code)
+{
+    if (IS_MOD(code)) return report->mods & MOD_BIT(code);
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        return (code>>3) < REPORT_BITS && (report->nkro.bits[code>>3] & (1<<(code&7)));
+    }
+#endif
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (report->keys[i] == code) return true;
+    }
+    return false;
+}
+
+/* whether key sends report of its own */
+static bool key_has_report(key_t key)
+{
+    action_t action = layer_switch_get_action(key);
+    switch (action.kind.id) {
+        case ACT_LMODS:
+        case ACT_RMODS:
+            return action.key.code || action.key.mods;
+        case ACT_MOUSEKEY:
+        case ACT_USAGE:
+            return true;
+    }
+    return false;
+}
+
+/* whether report of type carries key, report is given for keyboard */
+static bool report_has_key(enum report_type type, report_keyboard_t *report, key_t key)
+{
+    action_t action = layer_switch_get_action(key);
+    switch (action.kind.id) {
+        case ACT_LMODS:
+        case ACT_RMODS:
+            if (type != REPORT_KEYBOARD) return false;
+            if (action.key.code) return report_has_code(report, action.key.code);
+            return report->mods & (action.kind.id == ACT_LMODS ? action.key.mods : action.key.mods<<4);
+        case ACT_MOUSEKEY:
+            return type == REPORT_MOUSE;
+        case ACT_USAGE:
+            return type == (action.usage.page == PAGE_SYSTEM ? REPORT_SYSTEM : REPORT_CONSUMER);
+    }
+    return false;
+}
+
+/* track press applied to matrix until a report carries it */
+static void latency_track(size_t index)
+{
+    sim_event_t *e = &events[index];
+    key_t key = { .row = e->row, .col = e->col };
+    for (size_t i = 0; i < pending_len; i++) {
+        sim_event_t *p = &events[pending[i]];
+        if (p->row == e->row && p->col == e->col) {
+            pending[i] = pending[--pending_len];
+            unreported++;
+            break;
+        }
+    }
+    if (e->tap_key || !key_has_report(key)) return;
+    pending[pending_len++] = index;
+}
+
+static void sim_report(enum report_type type, report_keyboard_t *report)
+{
+    report_count++;
+    for (size_t i = 0; i < pending_len; ) {
+        sim_event_t *e = &events[pending[i]];
+        if (!report_has_key(type, report, (key_t){ .row = e->row, .col = e->col })) {
+            i++;
+            continue;
+        }
+        uint32_t latency = timer_read32() - e->time;
+        latencies[latency_count++] = latency;
+        latency_sum += latency;
+        pending[i] = pending[--pending_len];
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* host driver */
+static uint8_t keyboard_leds(void)
+{
+    return 0;
+}
+
+static void send_keyboard(report_keyboard_t *report)
+{
+    sim_report(REPORT_KEYBOARD, report);
+    if (quiet) return;
+    printf("%u keyboard", timer_read32());
+    for (uint8_t i = 0; i < REPORT_SIZE; i++) {
+        printf(" %02X", report->raw[i]);
+    }
+    printf("\n");
+}
+
+static void send_mouse(report_mouse_t *report)
+{
+    sim_report(REPORT_MOUSE, NULL);
+    if (quiet) return;
+    printf("%u mouse %02X %d %d %d %d\n", timer_read32(),
+           report->buttons, report->x, report->y, report->v, report->h);
+}
+
+static void send_system(uint16_t data)
+{
+    sim_report(REPORT_SYSTEM, NULL);
+    if (quiet) return;
+    printf("%u system %04X\n", timer_read32(), data);
+}
+
+static void send_consumer(uint16_t data)
+{
+    sim_report(REPORT_CONSUMER, NULL);
+    if (quiet) return;
+    printf("%u consumer %04X\n", timer_read32(), data);
+}
+
+static host_driver_t sim_driver = {
+    keyboard_leds,
+    send_keyboard,
+    send_mouse,
+    send_system,
+    send_consumer
+};
+
+void led_set(uint8_t usb_led)
+{
+}
+
+/* for bootmagic */
+void bootloader_jump(void)
+{
+}
+
+
+/* apply events due on virtual clock to matrix, called from matrix_scan() */
+void sim_event_task(void)
+{
+    while (events_next < events_len && events[events_next].time <= timer_read32()) {
+        sim_event_t *e = &events[events_next++];
+        e->tap_key = is_tap_key((key_t){ .row = e->row, .col = e->col });
+        if (e->pressed) latency_track(e - events);
+        sim_matrix_set(e->row, e->col, e->pressed);
+    }
+}
+
+static void read_trace(FILE *fp)
+{
+    char line[128];
+    size_t cap = 0;
+    unsigned long lineno = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        unsigned long time;
+        unsigned int row, col;
+        char c;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%lu %u %u %c", &time, &row, &col, &c) != 4 ||
+                (c != 'd' && c != 'u')) {
+            fprintf(stderr, "trace:%lu: invalid line\n", lineno);
+            continue;
+        }
+        if (events_len == cap) {
+            cap = cap ? cap * 2 : 256;
+            events = realloc(events, cap * sizeof(sim_event_t));
+            if (!events) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+        }
+        events[events_len++] = (sim_event_t){
+            .time = time, .row = row, .col = col, .pressed = (c == 'd')
+        };
+    }
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] == 'q') {
+            quiet = true;
+        } else {
+            fprintf(stderr, "usage: %s [-q] < trace\n", argv[0]);
+            return 1;
+        }
+    }
+    read_trace(stdin);
+    latencies = malloc((events_len ? events_len : 1) * sizeof(uint32_t));
+    pending = malloc((events_len ? events_len : 1) * sizeof(size_t));
+    if (!latencies || !pending) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    keyboard_init();
+    host_set_driver(&sim_driver);
+
+    uint32_t end = (events_len ? events[events_len - 1].time : 0) + SIM_SETTLE_TIME;
+    uint64_t tasks = 0;
+    clock_t clock_start = clock();
+    while (timer_read32() <= end) {
+        for (uint8_t i = 0; i < SIM_TASKS_PER_MS; i++) {
+            keyboard_task();
+            tasks++;
+        }
+#ifdef DEBUG_TRACE
+        uint8_t line[TRACE_LINE_SIZE];
+        if (trace_get_line(line) && !quiet) {
+            fwrite(line, 1, TRACE_LINE_SIZE, stdout);
+        }
+#endif
+        sim_timer_advance_us(1000);
+    }
+    double elapsed = (double)(clock() - clock_start) / CLOCKS_PER_SEC;
+
+    fprintf(stderr, "events: %zu reports: %u tasks: %llu\n",
+            events_len, report_count, (unsigned long long)tasks);
+    unreported += pending_len;
+    if (latency_count) {
+        qsort(latencies, latency_count, sizeof(uint32_t), compare_u32);
+        size_t delayed = 0;
+        while (delayed < latency_count && latencies[latency_count - 1 - delayed]) delayed++;
+        fprintf(stderr, "latency(ms): avg %.2f p50 %u p99 %u max %u delayed %zu/%zu p50 %u unreported %zu\n",
+                (double)latency_sum / latency_count,
+                latencies[latency_count * 50 / 100], latencies[latency_count * 99 / 100],
+                latencies[latency_count - 1], delayed, latency_count,
+                delayed ? latencies[latency_count - delayed + delayed / 2] : 0, unreported);
+    }
+    if (elapsed > 0) {
+        fprintf(stderr, "throughput: %.0f events/s %.0f tasks/s\n",
+                events_len / elapsed, tasks / elapsed);
+    }
+#ifdef LATENCY_TRACE
+    static const char *stage_names[LATENCY_STAGES] = {
+        "scan", NULL, NULL, "debounce", "action_exec", "process_action", "host_send", "endpoint"
+    };
+    latency_task();
+    for (uint8_t s = 0; s < LATENCY_STAGES; s++) {
+        if (!stage_names[s] || !latency_samples(s)) continue;
+        fprintf(stderr, "latency(us) %-14s n %u p50 %u p99 %u\n", stage_names[s],
+                latency_samples(s), latency_percentile(s, 50), latency_percentile(s, 99));
+    }
+#endif
+    uint32_t eeprom_writes, eeprom_wear, eeprom_blocked;
+    sim_eeprom_stats(&eeprom_writes, &eeprom_wear, &eeprom_blocked);
+    if (eeprom_writes) {
+        fprintf(stderr, "eeprom: writes %u max per cell %u blocked(ms) %u\n",
+                eeprom_writes, eeprom_wear, eeprom_blocked);
+    }
+#ifdef STARTUP_TRACE
+    static const char *startup_names[STARTUP_STAGES] = {
+        "matrix_init", "mouse_init", "bootmagic", "first_scan", "first_report"
+    };
+    for (uint8_t s = 0; s < STARTUP_STAGES; s++) {
+        if (!startup_reached(s)) continue;
+        fprintf(stderr, "startup(us) %-14s %u\n", startup_names[s], startup_time(s));
+    }
+#endif
+    return 0;
+}
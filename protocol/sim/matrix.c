@@ -0,0 +1,101 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "print.h"
+#include "util.h"
+#include "matrix.h"
+#include "sim.h"
+#ifdef SIM_DEBOUNCE
+#   include "debounce.h"
+#endif
+
+
+/* switch state set by simulation script(1:on, 0:off) */
+static matrix_row_t matrix[MATRIX_ROWS];
+#ifdef SIM_DEBOUNCE
+/* matrix seen by keyboard after common debounce */
+static matrix_row_t matrix_debounced[MATRIX_ROWS];
+#endif
+
+
+uint8_t matrix_rows(void)
+{
+    return MATRIX_ROWS;
+}
+
+uint8_t matrix_cols(void)
+{
+    return MATRIX_COLS;
+}
+
+void matrix_init(void)
+{
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) matrix[i] = 0;
+#ifdef SIM_DEBOUNCE
+    for (uint8_t i = 0; i < MATRIX_ROWS; i++) matrix_debounced[i] = 0;
+    debounce_init();
+#endif
+}
+
+uint8_t matrix_scan(void)
+{
+    sim_event_task();
+#ifdef SIM_DEBOUNCE
+    debounce(matrix, matrix_debounced);
+#endif
+    return 1;
+}
+
+bool matrix_is_modified(void)
+{
+    return true;
+}
+
+bool matrix_is_on(uint8_t row, uint8_t col)
+{
+    return (matrix_get_row(row) & ((matrix_row_t)1<<col));
+}
+
+matrix_row_t matrix_get_row(uint8_t row)
+{
+#ifdef SIM_DEBOUNCE
+    return matrix_debounced[row];
+#else
+    return matrix[row];
+#endif
+}
+
+void matrix_print(void)
+{
+    print("\nr/c 0123456789ABCDEF0123456789ABCDEF\n");
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        phex(row); print(": ");
+        print_bin_reverse32(matrix_get_row(row));
+        print("\n");
+    }
+}
+
+void sim_matrix_set(uint8_t row, uint8_t col, bool on)
+{
+    if (row >= MATRIX_ROWS || col >= MATRIX_COLS) return;
+    if (on) {
+        matrix[row] |= ((matrix_row_t)1<<col);
+    } else {
+        matrix[row] &= ~((matrix_row_t)1<<col);
+    }
+}
@@ -0,0 +1,36 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* advance virtual clock */
+void sim_timer_advance_us(uint32_t us);
+
+/* set switch state of scriptable matrix */
+void sim_matrix_set(uint8_t row, uint8_t col, bool on);
+
+/* apply trace events due now, matrix_scan() calls this */
+void sim_event_task(void);
+
+/* EEPROM byte writes in total, most writes to a cell and time blocked by writes */
+void sim_eeprom_stats(uint32_t *total, uint32_t *max_wear, uint32_t *blocked_ms);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Report key slots of action_util
+ *
+ * Feeds the same random add_key()/del_key()/clear_keys() streams to
+ * common/action_util.c, which keeps keycode to slot index, and to
+ * action_util_ref.c, the code before the index, and checks after each call
+ * against a model of pressed keys in order of press:
+ *
+ *   keys       keys in report as set. With USB_6KRO_ENABLE the oldest key is
+ *              popped when report is full, otherwise new key is ignored.
+ *   anykey     has_anykey() is not zero only with keys in report
+ *   first      get_first_key() is the oldest key with USB_6KRO_ENABLE, and
+ *              a key in report otherwise
+ *
+ * Current code must match the model always. Without USB_6KRO_ENABLE
+ * reference must give the same keys as well; streams where it goes wrong are
+ * counted, as it returns 0 from get_first_key() with keys in report, and in
+ * ring mode can leave a key twice in report. Exits with error on any
+ * violation.
+ *
+ * Then both are timed on typing: 5 adds, has_anykey() and 5 dels in other
+ * order, per call.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "report.h"
+#include "action_util.h"
+
+
+/* reference object, see action_util_ref.c */
+extern report_keyboard_t *ref_keyboard_report;
+void ref_add_key(uint8_t key);
+void ref_del_key(uint8_t key);
+void ref_clear_keys(void);
+uint8_t ref_has_anykey(void);
+uint8_t ref_get_first_key(void);
+
+#define SEEDS       2000
+#define CALLS       500
+#define CODES       10
+#define TYPING      2000000UL
+
+#ifdef USB_6KRO_ENABLE
+#   define MODE "ring"
+#else
+#   define MODE "plain"
+#endif
+
+static volatile uint8_t sink;
+
+void host_keyboard_send(report_keyboard_t *report) {}
+uint16_t timer_read(void) { return 0; }
+
+
+/* own generator, streams of a seed are the same on any host */
+static uint32_t rnd_state;
+static uint32_t rnd(uint32_t n)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return (rnd_state >> 8) % n;
+}
+
+/* pressed keys in order of press */
+static uint8_t model[REPORT_KEYS];
+static uint8_t model_len;
+
+static void model_add(uint8_t code)
+{
+    for (uint8_t i = 0; i < model_len; i++) {
+        if (model[i] == code) return;
+    }
+    if (model_len == REPORT_KEYS) {
+#ifdef USB_6KRO_ENABLE
+        memmove(model, model + 1, --model_len);
+#else
+        return;
+#endif
+    }
+    model[model_len++] = code;
+}
+
+static void model_del(uint8_t code)
+{
+    for (uint8_t i = 0; i < model_len; i++) {
+        if (model[i] == code) {
+            memmove(model + i, model + i + 1, --model_len - i);
+            return;
+        }
+    }
+}
+
+static bool in_model(uint8_t code)
+{
+    for (uint8_t i = 0; i < model_len; i++) {
+        if (model[i] == code) return true;
+    }
+    return false;
+}
+
+/* true when keys of report are the same set as model */
+static bool same_keys(report_keyboard_t *report)
+{
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (!report->keys[i]) continue;
+        if (!in_model(report->keys[i])) return false;
+        n++;
+    }
+    return n == model_len;
+}
+
+static bool matches_model(report_keyboard_t *report, uint8_t anykey, uint8_t first)
+{
+    if (!same_keys(report)) return false;
+    if (!anykey != !model_len) return false;
+    if (!model_len) return first == 0;
+#ifdef USB_6KRO_ENABLE
+    return first == model[0];
+#else
+    return in_model(first);
+#endif
+}
+
+static void print_keys(const char *name, report_keyboard_t *report)
+{
+    printf(" %s", name);
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) printf(" %02X", report->keys[i]);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double typing(void (*add)(uint8_t), void (*del)(uint8_t), uint8_t (*anykey)(void))
+{
+    static const uint8_t order[5] = { 2, 0, 4, 1, 3 };
+    double start = now_ns();
+    for (unsigned long i = 0; i < TYPING; i++) {
+        uint8_t base = 4 + i % 64;
+        for (uint8_t k = 0; k < 5; k++) add(base + k);
+        sink = anykey();
+        for (uint8_t k = 0; k < 5; k++) del(base + order[k]);
+    }
+    return (now_ns() - start) / (TYPING * 11);
+}
+
+int main(void)
+{
+    int calls = 0, failed = 0, ref_wrong = 0;
+    for (int seed = 1; seed <= SEEDS; seed++) {
+        rnd_state = seed;
+        clear_keys();
+        ref_clear_keys();
+        model_len = 0;
+        bool ref_ok = true;
+        for (int i = 0; i < CALLS; i++) {
+            uint8_t code = 4 + rnd(CODES);
+            uint32_t op = rnd(64);
+            const char *name;
+            if (op == 0) {
+                name = "clear";
+                clear_keys();
+                ref_clear_keys();
+                model_len = 0;
+            } else if (op < 36) {
+                name = "add";
+                add_key(code);
+                ref_add_key(code);
+                model_add(code);
+            } else {
+                name = "del";
+                del_key(code);
+                ref_del_key(code);
+                model_del(code);
+            }
+            calls++;
+
+            bool ok = matches_model(keyboard_report, has_anykey(), get_first_key());
+#ifndef USB_6KRO_ENABLE
+            // reference keeps the same keys, only order in report differs
+            if (!same_keys(ref_keyboard_report)) ok = false;
+#endif
+            if (ref_ok && !matches_model(ref_keyboard_report, ref_has_anykey(), ref_get_first_key())) {
+                ref_ok = false;
+                ref_wrong++;
+            }
+            if (ok) continue;
+            if (failed++ < 3) {
+                printf("seed %d call %d %s %02X:", seed, i, name, code);
+                print_keys("new", keyboard_report);
+                print_keys("ref", ref_keyboard_report);
+                printf(" first %02X ref %02X\n", get_first_key(), ref_get_first_key());
+            }
+        }
+    }
+    printf("action_util_keys: %s %d/%d calls ok, ref went wrong in %d/%d streams\n",
+           MODE, calls - failed, calls, ref_wrong, SEEDS);
+
+    clear_keys();
+    ref_clear_keys();
+    double ref_ns = typing(ref_add_key, ref_del_key, ref_has_anykey);
+    double new_ns = typing(add_key, del_key, has_anykey);
+    printf("action_util_keys: %s typing ns/call ref %5.1f new %5.1f\n", MODE, ref_ns, new_ns);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * Reference copy of common/action_util.c before report slots got keycode
+ * index. action_util_keys compares current code with this; keep it unchanged.
+ * Public names are prefixed with ref_ to link with current code.
+ */
+#define keyboard_report             ref_keyboard_report
+#define send_keyboard_report        ref_send_keyboard_report
+#define get_suppressed_report_count ref_get_suppressed_report_count
+#define add_key                     ref_add_key
+#define del_key                     ref_del_key
+#define clear_keys                  ref_clear_keys
+#define get_mods                    ref_get_mods
+#define add_mods                    ref_add_mods
+#define del_mods                    ref_del_mods
+#define set_mods                    ref_set_mods
+#define clear_mods                  ref_clear_mods
+#define get_weak_mods               ref_get_weak_mods
+#define add_weak_mods               ref_add_weak_mods
+#define del_weak_mods               ref_del_weak_mods
+#define set_weak_mods               ref_set_weak_mods
+#define clear_weak_mods             ref_clear_weak_mods
+#define set_oneshot_mods            ref_set_oneshot_mods
+#define clear_oneshot_mods          ref_clear_oneshot_mods
+#define has_anykey                  ref_has_anykey
+#define has_anymod                  ref_has_anymod
+#define get_first_key               ref_get_first_key
+
+#include "host.h"
+#include "report.h"
+#include "debug.h"
+#include "action_util.h"
+#include "timer.h"
+
+static inline void add_key_byte(uint8_t code);
+static inline void del_key_byte(uint8_t code);
+#ifdef NKRO_ENABLE
+static inline void add_key_bit(uint8_t code);
+static inline void del_key_bit(uint8_t code);
+#endif
+
+static uint8_t real_mods = 0;
+static uint8_t weak_mods = 0;
+
+/* keys part of report changed since last send */
+static bool keys_dirty = true;
+static uint8_t last_mods = 0;
+static uint16_t suppressed_count = 0;
+
+#ifdef USB_6KRO_ENABLE
+#define RO_ADD(a, b) ((a + b) % REPORT_KEYS)
+#define RO_SUB(a, b) ((a - b + REPORT_KEYS) % REPORT_KEYS)
+#define RO_INC(a) RO_ADD(a, 1)
+#define RO_DEC(a) RO_SUB(a, 1)
+static int8_t cb_head = 0;
+static int8_t cb_tail = 0;
+static int8_t cb_count = 0;
+#endif
+
+// TODO: pointer variable is not needed
+//report_keyboard_t keyboard_report = {};
+report_keyboard_t *keyboard_report = &(report_keyboard_t){};
+
+#ifndef NO_ACTION_ONESHOT
+static int8_t oneshot_mods = 0;
+#if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
+static int16_t oneshot_time = 0;
+#endif
+#endif
+
+
+void send_keyboard_report(void) {
+    keyboard_report->mods  = real_mods;
+    keyboard_report->mods |= weak_mods;
+#ifndef NO_ACTION_ONESHOT
+    if (oneshot_mods) {
+#if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
+        if (TIMER_DIFF_16(timer_read(), oneshot_time) >= ONESHOT_TIMEOUT) {
+            dprintf("Oneshot: timeout\n");
+            clear_oneshot_mods();
+        }
+#endif
+        keyboard_report->mods |= oneshot_mods;
+        if (has_anykey()) {
+            clear_oneshot_mods();
+        }
+    }
+#endif
+    /* send only real changes */
+    if (!keys_dirty && keyboard_report->mods == last_mods) {
+        suppressed_count++;
+        return;
+    }
+    keys_dirty = false;
+    last_mods = keyboard_report->mods;
+    host_keyboard_send(keyboard_report);
+}
+
+uint16_t get_suppressed_report_count(void)
+{
+    return suppressed_count;
+}
+
+/* key */
+void add_key(uint8_t key)
+{
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        add_key_bit(key);
+        return;
+    }
+#endif
+    add_key_byte(key);
+}
+
+void del_key(uint8_t key)
+{
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        del_key_bit(key);
+        return;
+    }
+#endif
+    del_key_byte(key);
+}
+
+void clear_keys(void)
+{
+    // not clear mods
+    for (int8_t i = 1; i < REPORT_SIZE; i++) {
+        if (keyboard_report->raw[i]) {
+            keyboard_report->raw[i] = 0;
+            keys_dirty = true;
+        }
+    }
+}
+
+
+/* modifier */
+uint8_t get_mods(void) { return real_mods; }
+void add_mods(uint8_t mods) { real_mods |= mods; }
+void del_mods(uint8_t mods) { real_mods &= ~mods; }
+void set_mods(uint8_t mods) { real_mods = mods; }
+void clear_mods(void) { real_mods = 0; }
+
+/* weak modifier */
+uint8_t get_weak_mods(void) { return weak_mods; }
+void add_weak_mods(uint8_t mods) { weak_mods |= mods; }
+void del_weak_mods(uint8_t mods) { weak_mods &= ~mods; }
+void set_weak_mods(uint8_t mods) { weak_mods = mods; }
+void clear_weak_mods(void) { weak_mods = 0; }
+
+/* Oneshot modifier */
+#ifndef NO_ACTION_ONESHOT
+void set_oneshot_mods(uint8_t mods)
+{
+    oneshot_mods = mods;
+#if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
+    oneshot_time = timer_read();
+#endif
+}
+void clear_oneshot_mods(void)
+{
+    oneshot_mods = 0;
+#if (defined(ONESHOT_TIMEOUT) && (ONESHOT_TIMEOUT > 0))
+    oneshot_time = 0;
+#endif
+}
+#endif
+
+
+
+
+/*
+ * inspect keyboard state
+ */
+uint8_t has_anykey(void)
+{
+    uint8_t cnt = 0;
+    for (uint8_t i = 1; i < REPORT_SIZE; i++) {
+        if (keyboard_report->raw[i])
+            cnt++;
+    }
+    return cnt;
+}
+
+uint8_t has_anymod(void)
+{
+    return bitpop(real_mods);
+}
+
+uint8_t get_first_key(void)
+{
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro) {
+        uint8_t i = 0;
+        for (; i < REPORT_BITS && !keyboard_report->nkro.bits[i]; i++)
+            ;
+        return i<<3 | biton(keyboard_report->nkro.bits[i]);
+    }
+#endif
+#ifdef USB_6KRO_ENABLE
+    uint8_t i = cb_head;
+    do {
+        if (keyboard_report->keys[i] != 0) {
+            break;
+        }
+        i = RO_INC(i);
+    } while (i != cb_tail);
+    return keyboard_report->keys[i];
+#else
+    return keyboard_report->keys[0];
+#endif
+}
+
+
+
+/* local functions */
+static inline void add_key_byte(uint8_t code)
+{
+#ifdef USB_6KRO_ENABLE
+    int8_t i = cb_head;
+    int8_t empty = -1;
+    if (cb_count) {
+        do {
+            if (keyboard_report->keys[i] == code) {
+                return;
+            }
+            if (empty == -1 && keyboard_report->keys[i] == 0) {
+                empty = i;
+            }
+            i = RO_INC(i);
+        } while (i != cb_tail);
+        if (i == cb_tail) {
+            if (cb_tail == cb_head) {
+                // buffer is full
+                if (empty == -1) {
+                    // pop head when has no empty space
+                    cb_head = RO_INC(cb_head);
+                    cb_count--;
+                }
+                else {
+                    // left shift when has empty space
+                    uint8_t offset = 1;
+                    i = RO_INC(empty);
+                    do {
+                        if (keyboard_report->keys[i] != 0) {
+                            keyboard_report->keys[empty] = keyboard_report->keys[i];
+                            keyboard_report->keys[i] = 0;
+                            empty = RO_INC(empty);
+                        }
+                        else {
+                            offset++;
+                        }
+                        i = RO_INC(i);
+                    } while (i != cb_tail);
+                    cb_tail = RO_SUB(cb_tail, offset);
+                }
+            }
+        }
+    }
+    // add to tail
+    keyboard_report->keys[cb_tail] = code;
+    keys_dirty = true;
+    cb_tail = RO_INC(cb_tail);
+    cb_count++;
+#else
+    int8_t i = 0;
+    int8_t empty = -1;
+    for (; i < REPORT_KEYS; i++) {
+        if (keyboard_report->keys[i] == code) {
+            break;
+        }
+        if (empty == -1 && keyboard_report->keys[i] == 0) {
+            empty = i;
+        }
+    }
+    if (i == REPORT_KEYS) {
+        if (empty != -1) {
+            keyboard_report->keys[empty] = code;
+            keys_dirty = true;
+        }
+    }
+#endif
+}
+
+static inline void del_key_byte(uint8_t code)
+{
+#ifdef USB_6KRO_ENABLE
+    uint8_t i = cb_head;
+    if (cb_count) {
+        do {
+            if (keyboard_report->keys[i] == code) {
+                keyboard_report->keys[i] = 0;
+                keys_dirty = true;
+                cb_count--;
+                if (cb_count == 0) {
+                    // reset head and tail
+                    cb_tail = cb_head = 0;
+                }
+                if (i == RO_DEC(cb_tail)) {
+                    // left shift when next to tail
+                    do {
+                        cb_tail = RO_DEC(cb_tail);
+                        if (keyboard_report->keys[RO_DEC(cb_tail)] != 0) {
+                            break;
+                        }
+                    } while (cb_tail != cb_head);
+                }
+                break;
+            }
+            i = RO_INC(i);
+        } while (i != cb_tail);
+    }
+#else
+    for (uint8_t i = 0; i < REPORT_KEYS; i++) {
+        if (keyboard_report->keys[i] == code) {
+            keyboard_report->keys[i] = 0;
+            keys_dirty = true;
+        }
+    }
+#endif
+}
+
+#ifdef NKRO_ENABLE
+static inline void add_key_bit(uint8_t code)
+{
+    if ((code>>3) < REPORT_BITS) {
+        if (!(keyboard_report->nkro.bits[code>>3] & 1<<(code&7))) {
+            keyboard_report->nkro.bits[code>>3] |= 1<<(code&7);
+            keys_dirty = true;
+        }
+    } else {
+        dprintf("add_key_bit: can't add: %02X\n", code);
+    }
+}
+
+static inline void del_key_bit(uint8_t code)
+{
+    if ((code>>3) < REPORT_BITS) {
+        if (keyboard_report->nkro.bits[code>>3] & 1<<(code&7)) {
+            keyboard_report->nkro.bits[code>>3] &= ~(1<<(code&7));
+            keys_dirty = true;
+        }
+    } else {
+        dprintf("del_key_bit: can't del: %02X\n", code);
+    }
+}
+#endif
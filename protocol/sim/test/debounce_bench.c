@@ -0,0 +1,193 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Debounce benchmark
+ *
+ * Feeds common/debounce.c with generated bounce traces on virtual clock and
+ * prints press/release latency and chatter of the algorithm it is built with.
+ *
+ * Each keystroke bounces for up to BOUNCE_MAX_US on press and on release with
+ * contact toggling every 50-500us, and some idle keys get a single noise spike
+ * of up to SPIKE_MAX_US. Latency is from the first raw edge to the debounced
+ * change. Chatter is debounced changes beyond one press and one release per
+ * keystroke, per 1000 keystrokes; spikes registered as keystrokes count here.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "matrix.h"
+#include "timer.h"
+#include "debounce.h"
+#include "sim.h"
+
+
+#define KEYSTROKES      5000
+#define KEYS            (MATRIX_ROWS * MATRIX_COLS)
+#define SCAN_US         250
+#define BOUNCE_MAX_US   3000
+#define SPIKE_MAX_US    400
+#define SPIKE_PERCENT   5
+#define TOGGLES_MAX     (KEYSTROKES * 2 * 2 * (BOUNCE_MAX_US / 50 + 2) / KEYS + 64)
+
+typedef struct {
+    uint32_t press;
+    uint32_t release;
+} stroke_t;
+
+/* raw contact toggles of each key in time order */
+static uint32_t toggles[KEYS][TOGGLES_MAX];
+static uint16_t toggles_len[KEYS];
+static stroke_t strokes[KEYS][KEYSTROKES];
+static uint16_t strokes_len[KEYS];
+
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+static void toggle(uint8_t k, uint32_t t)
+{
+    if (toggles_len[k] < TOGGLES_MAX) toggles[k][toggles_len[k]++] = t;
+}
+
+/* edge with bounce, ends in stable state */
+static uint32_t bounce(uint8_t k, uint32_t t)
+{
+    uint32_t end = t + rnd(BOUNCE_MAX_US + 1);
+    uint8_t n = 1;
+    toggle(k, t);
+    while (true) {
+        uint32_t next = t + 50 + rnd(451);
+        if (next >= end) break;
+        toggle(k, next);
+        n++;
+        t = next;
+    }
+    if (!(n & 1)) toggle(k, end);
+    return end;
+}
+
+static void generate(void)
+{
+    uint32_t busy[KEYS] = {};
+    uint32_t t = 100000;
+    for (uint16_t i = 0; i < KEYSTROKES; i++) {
+        uint8_t k;
+        do { k = rnd(KEYS); } while (busy[k] > t);
+        stroke_t *s = &strokes[k][strokes_len[k]++];
+        s->press = t;
+        bounce(k, t);
+        s->release = t + 30000 + rnd(120000);
+        busy[k] = bounce(k, s->release) + 20000;
+
+        if (rnd(100) < SPIKE_PERCENT) {
+            uint8_t j = rnd(KEYS);
+            uint32_t at = t + rnd(40000);
+            if (busy[j] < at) {
+                toggle(j, at);
+                toggle(j, at + 50 + rnd(SPIKE_MAX_US - 50));
+                busy[j] = at + 20000;
+            }
+        }
+        t += 20000 + rnd(80000);
+    }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(void)
+{
+    static uint32_t press_latency[KEYSTROKES], release_latency[KEYSTROKES];
+    uint16_t presses = 0, releases = 0;
+    uint32_t changes = 0;
+    uint16_t next_toggle[KEYS] = {};
+    uint16_t next_stroke[KEYS] = {};
+    bool registered[KEYS] = {};
+    matrix_row_t raw[MATRIX_ROWS] = {}, cooked[MATRIX_ROWS] = {};
+
+    generate();
+    for (uint8_t k = 0; k < KEYS; k++) {
+        qsort(toggles[k], toggles_len[k], sizeof(uint32_t), compare_u32);
+    }
+
+    timer_init();
+    debounce_init();
+    uint32_t end = 0;
+    for (uint8_t k = 0; k < KEYS; k++) {
+        if (toggles_len[k] && toggles[k][toggles_len[k] - 1] > end) end = toggles[k][toggles_len[k] - 1];
+    }
+    for (uint32_t now = 0; now < end + 100000; now += SCAN_US) {
+        sim_timer_advance_us(SCAN_US);
+        for (uint8_t k = 0; k < KEYS; k++) {
+            while (next_toggle[k] < toggles_len[k] && toggles[k][next_toggle[k]] <= now) {
+                raw[k / MATRIX_COLS] ^= ((matrix_row_t)1<<(k % MATRIX_COLS));
+                next_toggle[k]++;
+            }
+        }
+        matrix_row_t before[MATRIX_ROWS];
+        for (uint8_t r = 0; r < MATRIX_ROWS; r++) before[r] = cooked[r];
+        if (!debounce(raw, cooked)) continue;
+
+        for (uint8_t k = 0; k < KEYS; k++) {
+            matrix_row_t bit = ((matrix_row_t)1<<(k % MATRIX_COLS));
+            if (!((before[k / MATRIX_COLS] ^ cooked[k / MATRIX_COLS]) & bit)) continue;
+            changes++;
+            bool on = cooked[k / MATRIX_COLS] & bit;
+            if (on && !registered[k]) {
+                /* skip keystrokes missed so far */
+                while (next_stroke[k] < strokes_len[k] && strokes[k][next_stroke[k]].release <= now) {
+                    next_stroke[k]++;
+                }
+                if (next_stroke[k] < strokes_len[k] && now >= strokes[k][next_stroke[k]].press) {
+                    press_latency[presses++] = now - strokes[k][next_stroke[k]].press;
+                    registered[k] = true;
+                }
+            } else if (!on && registered[k] && now >= strokes[k][next_stroke[k]].release) {
+                release_latency[releases++] = now - strokes[k][next_stroke[k]].release;
+                registered[k] = false;
+                next_stroke[k]++;
+            }
+        }
+    }
+
+    qsort(press_latency, presses, sizeof(uint32_t), compare_u32);
+    qsort(release_latency, releases, sizeof(uint32_t), compare_u32);
+    printf("%-12s press(us) p50 %5u max %5u  release(us) p50 %5u max %5u  "
+           "missed %u  chatter/1000 %.1f\n",
+#if (DEBOUNCE == 0)
+           "none",
+#elif defined(DEBOUNCE_EAGER_PRESS)
+           "eager_press",
+#elif defined(DEBOUNCE_PER_ROW)
+           "per_row",
+#else
+           "defer",
+#endif
+           presses ? press_latency[presses / 2] : 0, presses ? press_latency[presses - 1] : 0,
+           releases ? release_latency[releases / 2] : 0, releases ? release_latency[releases - 1] : 0,
+           KEYSTROKES - presses,
+           (changes - 2.0 * presses) * 1000 / KEYSTROKES);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * eeconfig record ring reload test
+ *
+ * Builds common/eeconfig.c with EECONFIG_CACHE on EEPROM array of its own
+ * whose writes can be cut off after given number of bytes as by power loss.
+ * After each cut RAM state is dropped and settings are loaded again as on
+ * next boot.
+ *
+ *   init       eeconfig_init() on blank EEPROM cut after each byte: magic
+ *              must not be valid unless settings are
+ *   saves      600 saves, wrapping sequence byte many times around ring:
+ *              each reload gives last saved settings
+ *   cut save   each save cut after each byte of record: reload gives
+ *              settings of either the save or the one before
+ */
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+
+#define EECONFIG_CACHE
+
+#include "../../../common/eeconfig.c"
+
+
+/* EEPROM; writes stop after cut_after bytes and return to power_loss */
+static uint8_t rom[E2END + 1];
+static int cut_after = -1;
+static jmp_buf power_loss;
+
+uint8_t eeprom_read_byte(const uint8_t *p)
+{
+    return rom[(uintptr_t)p & E2END];
+}
+
+uint16_t eeprom_read_word(const uint16_t *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    return eeprom_read_byte(b) | eeprom_read_byte(b + 1)<<8;
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+    }
+}
+
+void eeprom_write_byte(uint8_t *p, uint8_t value)
+{
+    if (cut_after == 0) longjmp(power_loss, 1);
+    if (cut_after > 0) cut_after--;
+    rom[(uintptr_t)p & E2END] = value;
+}
+
+void eeprom_write_word(uint16_t *p, uint16_t value)
+{
+    uint8_t *b = (uint8_t *)p;
+    eeprom_write_byte(b, value & 0xFF);
+    eeprom_write_byte(b + 1, value>>8);
+}
+
+void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+    }
+}
+
+bool eeprom_is_ready(void) { return true; }
+void eeprom_busy_wait(void) {}
+
+uint16_t timer_read(void) { return 0; }
+uint16_t timer_elapsed(uint16_t last) { return 0; }
+
+
+/* drop RAM state as on power cycle */
+static void reboot(void)
+{
+    cut_after = -1;
+    loaded = false;
+    dirty = false;
+    out_pos = sizeof(eeconfig_record_t);
+}
+
+static void save(uint8_t debug, uint8_t keymap)
+{
+    eeconfig_write_debug(debug);
+    eeconfig_write_keymap(keymap);
+    eeconfig_flush();
+}
+
+static int failed = 0;
+static int cases = 0;
+
+static void check(bool ok, const char *name, int i, int cut)
+{
+    cases++;
+    if (ok) return;
+    failed++;
+    if (failed <= 10) {
+        printf("eeconfig_ring: %s %d cut after %d: debug %02X layer %02X keymap %02X\n", name, i, cut,
+               eeconfig_read_debug(), eeconfig_read_default_layer(), eeconfig_read_keymap());
+    }
+}
+
+int main(void)
+{
+    /* init on blank EEPROM */
+    for (int cut = 0; cut <= 20; cut++) {
+        memset(rom, 0xFF, sizeof(rom));
+        reboot();
+        cut_after = cut;
+        if (!setjmp(power_loss)) eeconfig_init();
+        reboot();
+        check(!eeconfig_is_enabled() || (eeconfig_read_debug() == 0 &&
+                                         eeconfig_read_default_layer() == 0 &&
+                                         eeconfig_read_keymap() == 0), "init", 0, cut);
+    }
+
+    /* saves around ring */
+    memset(rom, 0xFF, sizeof(rom));
+    reboot();
+    eeconfig_init();
+    for (int i = 1; i <= 600; i++) {
+        save(i, i * 7);
+        reboot();
+        check(eeconfig_read_debug() == (uint8_t)i && eeconfig_read_keymap() == (uint8_t)(i * 7),
+              "save", i, -1);
+    }
+
+    /* power loss after each byte of record */
+    for (int i = 601; i <= 601 + 2 * EECONFIG_CACHE_SLOTS; i++) {
+        for (int cut = 0; cut < (int)sizeof(eeconfig_record_t); cut++) {
+            uint8_t old_debug = eeconfig_read_debug();
+            uint8_t old_keymap = eeconfig_read_keymap();
+            cut_after = cut;
+            if (!setjmp(power_loss)) save(i, i * 7);
+            reboot();
+            uint8_t debug = eeconfig_read_debug();
+            uint8_t keymap = eeconfig_read_keymap();
+            check((debug == old_debug && keymap == old_keymap) ||
+                  (debug == (uint8_t)i && keymap == (uint8_t)(i * 7)), "cut save", i, cut);
+        }
+        save(i, i * 7);
+        reboot();
+        check(eeconfig_read_debug() == (uint8_t)i, "save after cut", i, -1);
+    }
+
+    printf("eeconfig_ring: %d/%d cases ok\n", cases - failed, cases);
+    return failed ? 1 : 0;
+}
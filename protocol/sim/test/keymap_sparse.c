@@ -0,0 +1,157 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Sparse keymap tables of converters
+ *
+ * Hand-written keymap_codes[] and keymap_ranks[] of a converter must agree
+ * with KEYMAP_CODES and with order of keycodes in its KEYMAP macro, otherwise
+ * keys silently get keycode of other code. Checks on converter keymap:
+ *
+ *   tables     bits of keymap_codes[] add up to KEYMAP_CODES and
+ *              keymap_ranks[] counts them
+ *   macro      KEYMAP macro given each key as its own code(NO+code) puts
+ *              KEYMAP_CODES codes in order of keymap_codes[], that is key of
+ *              code lands where dense 32x8 keymap had it
+ *   overlays   entries are sorted by layer and code, codes exist and layers
+ *              are after keymaps[]
+ *   lookup     keymap_key_to_keycode() of every layer and code equals dense
+ *              keymap rebuilt from keymaps[] and keymap_overlays[]
+ *
+ * Exits with error on any mismatch.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* keymap macro of converter with each key given as its own code */
+#ifdef USB_USB
+#   include "../../../converter/usb_usb/keymap.c"
+#   define CONVERTER "usb_usb"
+#   define KEYMAP_IDENTITY KEYMAP( \
+    NO+0x29, NO+0x3A, NO+0x3B, NO+0x3C, NO+0x3D, NO+0x3E, NO+0x3F, NO+0x40, NO+0x41, NO+0x42, \
+    NO+0x43, NO+0x44, NO+0x45, NO+0x46, NO+0x47, NO+0x48, NO+0x35, NO+0x1E, NO+0x1F, NO+0x20, \
+    NO+0x21, NO+0x22, NO+0x23, NO+0x24, NO+0x25, NO+0x26, NO+0x27, NO+0x2D, NO+0x2E, NO+0x2A, \
+    NO+0x49, NO+0x4A, NO+0x4B, NO+0x53, NO+0x54, NO+0x55, NO+0x56, NO+0x2B, NO+0x14, NO+0x1A, \
+    NO+0x08, NO+0x15, NO+0x17, NO+0x1C, NO+0x18, NO+0x0C, NO+0x12, NO+0x13, NO+0x2F, NO+0x30, \
+    NO+0x31, NO+0x4C, NO+0x4D, NO+0x4E, NO+0x5F, NO+0x60, NO+0x61, NO+0x39, NO+0x04, NO+0x16, \
+    NO+0x07, NO+0x09, NO+0x0A, NO+0x0B, NO+0x0D, NO+0x0E, NO+0x0F, NO+0x33, NO+0x34, NO+0x28, \
+    NO+0x5C, NO+0x5D, NO+0x5E, NO+0x57, NO+0xE1, NO+0x1D, NO+0x1B, NO+0x06, NO+0x19, NO+0x05, \
+    NO+0x11, NO+0x10, NO+0x36, NO+0x37, NO+0x38, NO+0xE5, NO+0x52, NO+0x59, NO+0x5A, NO+0x5B, \
+    NO+0xE0, NO+0xE3, NO+0xE2, NO+0x2C, NO+0xE6, NO+0xE7, NO+0x65, NO+0xE4, NO+0x50, NO+0x51, \
+    NO+0x4F, NO+0x62, NO+0x63, NO+0x58 \
+)
+#else
+#   include "keymap_common.h"
+#   define CONVERTER "ps2_usb"
+#   define KEYMAP_IDENTITY KEYMAP_ALL( \
+    NO+0x76, NO+0x05, NO+0x06, NO+0x04, NO+0x0C, NO+0x03, NO+0x0B, NO+0x83, NO+0x0A, NO+0x01, \
+    NO+0x09, NO+0x78, NO+0x07, NO+0xFC, NO+0x7E, NO+0xFE, NO+0x0E, NO+0x16, NO+0x1E, NO+0x26, \
+    NO+0x25, NO+0x2E, NO+0x36, NO+0x3D, NO+0x3E, NO+0x46, NO+0x45, NO+0x4E, NO+0x55, NO+0x66, \
+    NO+0xF0, NO+0xEC, NO+0xFD, NO+0x77, NO+0xCA, NO+0x7C, NO+0x7B, NO+0x0D, NO+0x15, NO+0x1D, \
+    NO+0x24, NO+0x2D, NO+0x2C, NO+0x35, NO+0x3C, NO+0x43, NO+0x44, NO+0x4D, NO+0x54, NO+0x5B, \
+    NO+0x5D, NO+0xF1, NO+0xE9, NO+0xFA, NO+0x6C, NO+0x75, NO+0x7D, NO+0x58, NO+0x1C, NO+0x1B, \
+    NO+0x23, NO+0x2B, NO+0x34, NO+0x33, NO+0x3B, NO+0x42, NO+0x4B, NO+0x4C, NO+0x52, NO+0x5A, \
+    NO+0x6B, NO+0x73, NO+0x74, NO+0x79, NO+0x12, NO+0x1A, NO+0x22, NO+0x21, NO+0x2A, NO+0x32, \
+    NO+0x31, NO+0x3A, NO+0x41, NO+0x49, NO+0x4A, NO+0x59, NO+0xF5, NO+0x69, NO+0x72, NO+0x7A, \
+    NO+0x14, NO+0x9F, NO+0x11, NO+0x29, NO+0x91, NO+0xA7, NO+0xAF, NO+0x94, NO+0xEB, NO+0xF2, \
+    NO+0xF4, NO+0x70, NO+0x71, NO+0xDA, NO+0x61, NO+0x51, NO+0x13, NO+0x6A, NO+0x64, NO+0x67, \
+    NO+0x08, NO+0x10, NO+0x18, NO+0x20, NO+0x28, NO+0x30, NO+0x38, NO+0x40, NO+0x48, NO+0x50, \
+    NO+0x57, NO+0x5F, NO+0xB7, NO+0xBF, NO+0xDE, NO+0xA3, NO+0xB2, NO+0xA1, NO+0xCD, NO+0x95, \
+    NO+0xBB, NO+0xB4, NO+0xD0, NO+0xC8, NO+0xAB, NO+0xC0, NO+0x90, NO+0xBA, NO+0xB8, NO+0xB0, \
+    NO+0xA8, NO+0xA0, NO+0x98 \
+)
+#endif
+
+
+static const uint8_t identity[] = KEYMAP_IDENTITY;
+
+static int failed = 0;
+
+static void check(bool ok, const char *what, int layer, int code, int got, int want)
+{
+    if (ok) return;
+    if (failed++ < 10) {
+        printf("keymap_sparse: %s %s layer %d code %02X: %02X, expected %02X\n",
+               CONVERTER, what, layer, code, got, want);
+    }
+}
+
+/* keycode of code on layer as dense keymap had it */
+static uint8_t dense_keycode(uint8_t layer, uint8_t code)
+{
+    if (!(keymap_codes[code>>3] & (1<<(code&7)))) return KC_NO;
+    if (layer < keymaps_size) {
+        for (uint8_t i = 0; i < KEYMAP_CODES; i++) {
+            if (identity[i] == code) return keymaps[layer][i];
+        }
+        return KC_NO;
+    }
+    for (uint16_t i = 0; i < keymap_overlays_size; i++) {
+        if (keymap_overlays[i].layer == layer && keymap_overlays[i].code == code) {
+            return keymap_overlays[i].keycode;
+        }
+    }
+    return KC_TRNS;
+}
+
+int main(void)
+{
+    /* tables */
+    int codes = 0;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        check(keymap_ranks[row] == codes, "rank", -1, row<<3, keymap_ranks[row], codes);
+        codes += bitpop(keymap_codes[row]);
+    }
+    check(codes == KEYMAP_CODES, "KEYMAP_CODES", -1, 0, KEYMAP_CODES, codes);
+
+    /* macro */
+    check(sizeof(identity) == KEYMAP_CODES, "KEYMAP size", -1, 0, sizeof(identity), KEYMAP_CODES);
+    uint8_t i = 0;
+    for (int code = 0; code < MATRIX_ROWS * 8 && i < sizeof(identity); code++) {
+        if (!(keymap_codes[code>>3] & (1<<(code&7)))) continue;
+        check(identity[i] == code, "KEYMAP order", -1, code, identity[i], code);
+        i++;
+    }
+
+    /* overlays */
+    uint8_t last_layer = keymaps_size;
+    for (uint16_t n = 0; n < keymap_overlays_size; n++) {
+        keymap_overlay_t e = keymap_overlays[n];
+        check(keymap_codes[e.code>>3] & (1<<(e.code&7)), "overlay code", e.layer, e.code, e.keycode, KC_NO);
+        check(e.layer >= keymaps_size, "overlay layer", e.layer, e.code, e.keycode, KC_NO);
+        if (n) {
+            keymap_overlay_t p = keymap_overlays[n - 1];
+            check((p.layer<<8 | p.code) < (e.layer<<8 | e.code), "overlay order", e.layer, e.code, e.keycode, KC_NO);
+        }
+        if (e.layer > last_layer) last_layer = e.layer;
+    }
+
+    /* lookup */
+    for (uint8_t layer = 0; layer <= last_layer; layer++) {
+        for (int code = 0; code < MATRIX_ROWS * 8; code++) {
+            uint8_t got = keymap_key_to_keycode(layer, (key_t){ .row = code>>3, .col = code&7 });
+            uint8_t want = dense_keycode(layer, code);
+            check(got == want, "lookup", layer, code, got, want);
+        }
+    }
+
+    printf("keymap_sparse: %s %s %d codes, %d layers, %d overlay entries: %s\n",
+           CONVERTER, KEYMAP_NAME, KEYMAP_CODES, keymaps_size, keymap_overlays_size,
+           failed ? "mismatch" : "ok");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Layer lookup benchmark
+ *
+ * Measures layer_switch_get_action() of common/action_layer.c, built with or
+ * without ACTION_LAYER_CACHE, for number of active layers. Keymap has every
+ * key on layer 0 and each key on at most one upper layer, others are
+ * transparent, so that a lookup walks down through the active layers. Each
+ * key is looked up twice in a row as on press and release.
+ *
+ *   steady     layer state doesn't change between lookups
+ *   layer_key  layer state changes every 16 lookups, as with layer keys held
+ *              while typing
+ *
+ * Cost is shown as action_for_key() calls per lookup, which is what the
+ * lookup costs on AVR where action_for_key() reads keymap from flash, and as
+ * host time per lookup.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "keyboard.h"
+#include "action.h"
+#include "action_layer.h"
+#include "action_code.h"
+
+
+#define LOOKUPS 2000000UL
+
+static unsigned long calls;
+static volatile uint16_t sink;
+
+action_t action_for_key(uint8_t layer, key_t key)
+{
+    action_t action;
+    calls++;
+    if (layer == 0 || (key.row * MATRIX_COLS + key.col) % 32 == layer) {
+        action.code = ACTION_KEY(layer + key.col + 4);
+    } else {
+        action.code = ACTION_TRANSPARENT;
+    }
+    return action;
+}
+
+void clear_keyboard_but_mods(void) {}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(const char *name, uint8_t depth, uint8_t change_every)
+{
+    uint32_t state = (depth >= 32 ? 0xFFFFFFFE : ((1UL<<depth) - 1) & ~1UL);
+    layer_clear();
+    layer_or(state);
+    calls = 0;
+    double start = now_ns();
+    for (unsigned long i = 0; i < LOOKUPS; i++) {
+        if (change_every && i % change_every == 0) {
+            layer_xor(1UL<<31);
+            layer_xor(1UL<<31);
+        }
+        unsigned long k = i / 2;
+        key_t key = { .row = k % MATRIX_ROWS, .col = (k / MATRIX_ROWS) % MATRIX_COLS };
+        sink = layer_switch_get_action(key).code;
+    }
+    double ns = (now_ns() - start) / LOOKUPS;
+    printf("%-6s %-10s layers %2u  calls/lookup %5.2f  ns/lookup %6.1f\n",
+#ifdef ACTION_LAYER_CACHE
+           "cache",
+#else
+           "walk",
+#endif
+           name, depth, (double)calls / LOOKUPS, ns);
+}
+
+int main(void)
+{
+    static const uint8_t depths[] = { 1, 2, 4, 8, 16, 32 };
+    for (uint8_t i = 0; i < sizeof(depths); i++) {
+        bench("steady", depths[i], 0);
+    }
+    for (uint8_t i = 0; i < sizeof(depths); i++) {
+        bench("layer_key", depths[i], 16);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* avr-libc replacement for matrix_idle_sim: port registers of gh60 matrix */
+#ifndef SIM_IO_H
+#define SIM_IO_H
+
+#include <stdint.h>
+
+static uint8_t SREG __attribute__ ((unused));
+
+extern volatile uint8_t DDRB, PORTB, DDRC, PORTC, DDRD, PORTD, DDRE, PORTE, DDRF, PORTF;
+
+/* input pins as switches pull them through selected rows */
+uint8_t sim_pin_read(char port);
+#define PINB sim_pin_read('B')
+#define PINC sim_pin_read('C')
+#define PIND sim_pin_read('D')
+#define PINE sim_pin_read('E')
+#define PINF sim_pin_read('F')
+
+#endif
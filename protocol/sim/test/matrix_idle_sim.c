@@ -0,0 +1,161 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Idle scan of gh60 matrix
+ *
+ * Builds keyboard/gh60/matrix.c on port registers of matrix_idle_pins/avr/io.h
+ * where a pressed switch pulls its column pin low while its row is selected.
+ * Runs 60s of main loop on virtual clock: 3s typing burst every 15s, a
+ * keystroke every 150ms held 60ms, on keys of each column port. Row waits of
+ * matrix_scan() advance the clock, each pin read costs PIN_READ_NS and rest
+ * of main loop costs LOOP_US.
+ *
+ *   in scan    share of time in matrix_scan(), MCU current roughly follows
+ *              it unless asleep
+ *   asleep     share of time in sleep with MATRIX_IDLE_SLEEP
+ *   idle       share of loops which only read columns
+ *   latency    from switch press to matrix_get_row()
+ *
+ * Exits with error when a press is not seen or is seen later than
+ * MAX_LATENCY_US.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include "timer.h"
+#include "sim.h"
+#include "matrix.h"
+#include "matrix_idle.h"
+
+
+#define RUN_MS          60000UL
+#define LOOP_US         20
+#define PIN_READ_NS     250
+#define MAX_LATENCY_US  ((DEBOUNCE + 2) * 1000UL)
+
+#if defined(MATRIX_IDLE_SLEEP)
+#   define MODE "idle sleep"
+#elif defined(MATRIX_IDLE_ENABLE)
+#   define MODE "idle"
+#else
+#   define MODE "scan"
+#endif
+
+volatile uint8_t DDRB, PORTB, DDRC, PORTC, DDRD, PORTD, DDRE, PORTE, DDRF, PORTF;
+
+
+/* key of matrix on row pin of port D and column pin */
+typedef struct {
+    uint8_t row;
+    uint8_t col;
+    uint8_t row_bit;
+    char col_port;
+    uint8_t col_bit;
+} sim_key_t;
+
+static const sim_key_t keys[] = {
+    { 2,  0, 2, 'F', 0 },
+    { 0,  3, 0, 'C', 7 },
+    { 4,  8, 5, 'B', 0 },
+    { 1, 11, 1, 'D', 7 },
+    { 3,  2, 3, 'E', 6 },
+};
+
+static const sim_key_t *down = NULL;
+static uint16_t read_ns = 0;
+static uint32_t sleep_us = 0;
+
+uint8_t sim_pin_read(char port)
+{
+    read_ns += PIN_READ_NS;
+    if (read_ns >= 1000) {
+        sim_timer_advance_us(read_ns / 1000);
+        read_ns %= 1000;
+    }
+    uint8_t pins = 0xFF;
+    if (down && down->col_port == port &&
+            (DDRD & (1<<down->row_bit)) && !(PORTD & (1<<down->row_bit))) {
+        pins &= ~(1<<down->col_bit);
+    }
+    return pins;
+}
+
+/* idle sleep until next 1ms timer interrupt */
+void sim_sleep(void)
+{
+    uint32_t now = timer_read_us();
+    uint32_t wake = (now / 1000 + 1) * 1000;
+    sleep_us += wake - now;
+    sim_timer_advance_us(wake - now);
+}
+
+
+int main(void)
+{
+    timer_init();
+    matrix_init();
+
+    unsigned long loops = 0, idle_loops = 0;
+    unsigned long presses = 0, seen = 0, missed = 0, late = 0;
+    uint32_t press_at = 0, lat_sum = 0, lat_max = 0;
+    uint32_t scan_us = 0;
+    bool pending = false;
+    uint8_t next = 0;
+    const sim_key_t *key = NULL;
+
+    while (timer_read32() < RUN_MS) {
+        uint32_t ms = timer_read32();
+        bool want = (ms % 15000) < 3000 && (ms % 150) < 60;
+        if (want && !down) {
+            if (pending) missed++;
+            key = &keys[next];
+            next = (next + 1) % (sizeof(keys) / sizeof(keys[0]));
+            down = key;
+            press_at = timer_read_us();
+            pending = true;
+            presses++;
+        }
+        if (!want) down = NULL;
+
+        if (matrix_idle()) idle_loops++;
+        uint32_t start = timer_read_us();
+        uint32_t slept = sleep_us;
+        matrix_scan();
+        scan_us += (timer_read_us() - start) - (sleep_us - slept);
+        loops++;
+
+        if (pending && (matrix_get_row(key->row) & ((matrix_row_t)1<<key->col))) {
+            uint32_t lat = timer_read_us() - press_at;
+            lat_sum += lat;
+            if (lat > lat_max) lat_max = lat;
+            if (lat > MAX_LATENCY_US) late++;
+            pending = false;
+            seen++;
+        }
+        sim_timer_advance_us(LOOP_US);
+    }
+    if (pending) missed++;
+
+    double run_us = RUN_MS * 1000.0;
+    printf("matrix_idle_sim: %-10s in scan %5.1f%%, asleep %5.1f%%, idle %5.1f%% of %lu loops, "
+           "presses %lu/%lu seen, latency avg %luus max %luus\n",
+           MODE, 100.0 * scan_us / run_us, 100.0 * sleep_us / run_us, 100.0 * idle_loops / loops, loops,
+           seen, presses, seen ? (unsigned long)(lat_sum / seen) : 0UL, (unsigned long)lat_max);
+    return (missed || late || seen != presses) ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * PS/2 mouse packet framing test
+ *
+ * Builds protocol/ps2_mouse.c in stream mode with PS/2 host replaced by byte
+ * queue and feeds it byte streams on virtual clock: packets split over tasks,
+ * bytes out of sync, partial packet abandoned by timeout, overflow and
+ * IntelliMouse 4-byte packets. Reports sent to host are checked against
+ * expected ones.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+
+
+/* PS/2 lines are never driven, host API below is stubbed */
+static uint8_t ps2_reg[6];
+#define PS2_CLOCK_PORT  ps2_reg[0]
+#define PS2_CLOCK_PIN   ps2_reg[1]
+#define PS2_CLOCK_DDR   ps2_reg[2]
+#define PS2_CLOCK_BIT   0
+#define PS2_DATA_PORT   ps2_reg[3]
+#define PS2_DATA_PIN    ps2_reg[4]
+#define PS2_DATA_DDR    ps2_reg[5]
+#define PS2_DATA_BIT    1
+#define PS2_USE_INT
+#define PS2_MOUSE_STREAM_MODE
+
+#include "../../ps2_mouse.c"
+
+
+debug_config_t debug_config;
+
+/* bytes from mouse; responses for init and packets for task */
+static uint8_t rx[64];
+static uint8_t rx_len, rx_pos;
+
+uint8_t ps2_error = PS2_ERR_NONE;
+
+void ps2_host_init(void) {}
+
+uint8_t ps2_host_send(uint8_t data)
+{
+    (void)data;
+    ps2_error = PS2_ERR_NONE;
+    return PS2_ACK;
+}
+
+uint8_t ps2_host_recv(void)
+{
+    if (rx_pos == rx_len) {
+        ps2_error = PS2_ERR_NODATA;
+        return 0;
+    }
+    ps2_error = PS2_ERR_NONE;
+    return rx[rx_pos++];
+}
+
+uint8_t ps2_host_recv_response(void)
+{
+    return ps2_host_recv();
+}
+
+/* reports sent to host */
+static report_mouse_t sent[16];
+static uint8_t sent_len;
+
+void host_mouse_send(report_mouse_t *report)
+{
+    if (sent_len < sizeof(sent)/sizeof(sent[0])) sent[sent_len] = *report;
+    sent_len++;
+}
+
+
+static void feed(const uint8_t *data, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++) rx[rx_len++] = data[i];
+}
+#define FEED(...)   do { static const uint8_t d[] = { __VA_ARGS__ }; feed(d, sizeof(d)); } while (0)
+
+static void wait_ms(uint16_t ms)
+{
+    sim_timer_advance_us((uint32_t)ms * 1000);
+}
+
+static void start(uint8_t size)
+{
+    rx_len = rx_pos = 0;
+    sent_len = 0;
+    packet_len = 0;
+    packet_size = size;
+    motion_clear(&motion);
+}
+
+static uint8_t failed = 0;
+static uint8_t cases = 0;
+
+static void check(const char *name, const report_mouse_t *expect, uint8_t len)
+{
+    bool ok = (sent_len == len);
+    for (uint8_t i = 0; ok && i < len; i++) {
+        ok = sent[i].buttons == expect[i].buttons && sent[i].x == expect[i].x &&
+             sent[i].y == expect[i].y && sent[i].v == expect[i].v && sent[i].h == expect[i].h;
+    }
+    cases++;
+    if (ok) return;
+    failed++;
+    printf("ps2_mouse_framing: %s: expected %u reports, sent %u\n", name, len, sent_len);
+    for (uint8_t i = 0; i < sent_len && i < sizeof(sent)/sizeof(sent[0]); i++) {
+        printf("  [%02X|%d %d %d %d]\n", sent[i].buttons, sent[i].x, sent[i].y, sent[i].v, sent[i].h);
+    }
+}
+#define CHECK(name, ...)    do { \
+    static const report_mouse_t e[] = { __VA_ARGS__ }; \
+    check(name, e, sizeof(e)/sizeof(e[0])); \
+} while (0)
+#define CHECK_NONE(name)    check(name, NULL, 0)
+
+#define R(b, dx, dy, dv)    { .buttons = b, .x = dx, .y = dy, .v = dv, .h = 0 }
+
+
+int main(void)
+{
+    timer_init();
+
+    /* IntelliMouse is detected by device ID 3 after sample rate sequence */
+    start(3);
+    FEED(0xAA, 0x00, 0x03);
+    ps2_mouse_init();
+    cases++;
+    if (packet_size != 4) { failed++; printf("ps2_mouse_framing: init wheel: size %u\n", packet_size); }
+
+    start(4);
+    FEED(0xAA, 0x00, 0x00);
+    ps2_mouse_init();
+    cases++;
+    if (packet_size != 3) { failed++; printf("ps2_mouse_framing: init no wheel: size %u\n", packet_size); }
+
+    start(3);
+    FEED(0x08, 0x05, 0x03);
+    ps2_mouse_task();
+    CHECK("packet", R(0, 5, -3, 0));
+
+    start(3);
+    FEED(0x08, 0x01, 0x00, 0x08, 0x02, 0x00);
+    ps2_mouse_task();
+    CHECK("back to back", R(0, 1, 0, 0), R(0, 2, 0, 0));
+
+    /* byte without bit3 can't be first byte and is dropped */
+    start(3);
+    FEED(0x05, 0x09, 0x01, 0x00, 0x08, 0x00, 0x00);
+    ps2_mouse_task();
+    CHECK("out of sync", R(1, 1, 0, 0), R(0, 0, 0, 0));
+
+    /* packet straddles tasks within timeout */
+    start(3);
+    FEED(0x09, 0x02);
+    ps2_mouse_task();
+    CHECK_NONE("split head");
+    wait_ms(PS2_MOUSE_PACKET_TIMEOUT / 2);
+    FEED(0x00, 0x08, 0x00, 0x00);
+    ps2_mouse_task();
+    CHECK("split tail", R(1, 2, 0, 0), R(0, 0, 0, 0));
+
+    /* lost byte: partial packet is abandoned and next packet starts clean */
+    start(3);
+    FEED(0x08, 0x07);
+    ps2_mouse_task();
+    wait_ms(PS2_MOUSE_PACKET_TIMEOUT + 10);
+    FEED(0x08, 0x01, 0x01);
+    ps2_mouse_task();
+    CHECK("timeout", R(0, 1, -1, 0));
+
+    /* 9-bit sign and y inverted for USB */
+    start(3);
+    FEED(0x38, 0xFE, 0xFD);
+    ps2_mouse_task();
+    CHECK("sign", R(0, -2, 3, 0));
+
+    /* overflow is taken as limit and sent over successive reports */
+    start(3);
+    FEED(0x48, 0xFF, 0x00);
+    ps2_mouse_task();
+    ps2_mouse_task();
+    CHECK("overflow", R(0, 127, 0, 0), R(0, 127, 0, 0), R(0, 1, 0, 0));
+
+    /* IntelliMouse: 4th byte is wheel, positive is down */
+    start(4);
+    FEED(0x08, 0x00, 0x00, 0x01, 0x08, 0x00, 0x00, 0xFF);
+    ps2_mouse_task();
+    CHECK("wheel", R(0, 0, 0, -1), R(0, 0, 0, 1));
+
+    start(4);
+    FEED(0x08, 0x00, 0x00);
+    ps2_mouse_task();
+    wait_ms(PS2_MOUSE_PACKET_TIMEOUT + 10);
+    FEED(0x08, 0x03, 0x00, 0x00);
+    ps2_mouse_task();
+    CHECK("wheel timeout", R(0, 3, 0, 0));
+
+    printf("ps2_mouse_framing: %u/%u cases ok\n", cases - failed, cases);
+    return failed ? 1 : 0;
+}
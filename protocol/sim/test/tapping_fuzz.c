@@ -0,0 +1,210 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Tapping fuzzer
+ *
+ * Feeds the same random press/release/tick streams to common/action_tapping.c
+ * and to action_tapping_ref.c, the code before waiting_buffer got key index
+ * and overflow handling, and compares the records they pass to
+ * process_action().
+ *
+ *     tapping_fuzz [seeds [keys [max_gap_ms]]]
+ *
+ * Keys of column 0 and 1 are tap keys(mod-tap), others are plain keys. Each
+ * stream ends with all keys released and ticks beyond TAPPING_TERM.
+ *
+ * Current code must never clear keyboard on overflow and must not end with
+ * keys down in more streams than reference. With reference of the same
+ * WAITING_BUFFER_SIZE, streams reference handled without overflow must give
+ * identical records. Exits with error on any violation.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "action.h"
+#include "action_tapping.h"
+#include "action_code.h"
+#include "keycode.h"
+
+
+/* waiting_buffer size of reference object */
+#ifndef REF_WAITING_BUFFER_SIZE
+#define REF_WAITING_BUFFER_SIZE WAITING_BUFFER_SIZE
+#endif
+
+/* both objects are built with action_tapping_process renamed */
+void tapping_ref_process(keyrecord_t record);
+void tapping_new_process(keyrecord_t record);
+
+enum { REF, NEW };
+
+#define LOG_SIZE    16384
+
+static uint16_t now;
+static uint8_t which;
+static char logs[2][LOG_SIZE];
+static int log_len[2];
+static int clears[2];
+static bool down[2][MATRIX_ROWS][MATRIX_COLS];
+
+/* own generator, streams of a seed are the same on any host */
+static uint32_t rnd_state;
+static uint32_t rnd(uint32_t n)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return (rnd_state >> 8) % n;
+}
+
+static int arg(int argc, char **argv, int i, int def)
+{
+    int v;
+    return (argc > i && sscanf(argv[i], "%d", &v) == 1) ? v : def;
+}
+
+
+uint16_t timer_read(void)
+{
+    return now;
+}
+
+void process_action(keyrecord_t *record)
+{
+    keyevent_t e = record->event;
+    if (IS_NOEVENT(e)) return;
+    log_len[which] += snprintf(logs[which] + log_len[which], LOG_SIZE - log_len[which],
+                               "%u%u%c%u%c ", e.key.row, e.key.col, e.pressed ? 'd' : 'u',
+                               record->tap.count, record->tap.interrupted ? 'i' : '-');
+    if (log_len[which] >= LOG_SIZE) log_len[which] = LOG_SIZE - 1;
+    down[which][e.key.row][e.key.col] = e.pressed;
+}
+
+void clear_keyboard(void)
+{
+    clears[which]++;
+    memset(down[which], 0, sizeof(down[which]));
+}
+
+action_t layer_switch_get_action(key_t key)
+{
+    action_t action;
+    if (key.col < 2)
+        action.code = ACTION_MODS_TAP_KEY(MOD_LSFT, KC_A + key.col);
+    else
+        action.code = ACTION_KEY(KC_C + key.col);
+    return action;
+}
+
+bool is_tap_key(key_t key)
+{
+    return key.col < 2;
+}
+
+void debug_record(keyrecord_t record) {}
+void debug_event(keyevent_t event) {}
+
+
+static void feed(keyevent_t event)
+{
+    which = REF;
+    tapping_ref_process((keyrecord_t){ .event = event });
+    which = NEW;
+    tapping_new_process((keyrecord_t){ .event = event });
+}
+
+static void wait_ms(unsigned ms)
+{
+    for (unsigned i = 0; i < ms; i += 5) {
+        now += 5;
+        feed(TICK);
+    }
+}
+
+static bool any_down(uint8_t w)
+{
+    for (uint8_t r = 0; r < MATRIX_ROWS; r++)
+        for (uint8_t c = 0; c < MATRIX_COLS; c++)
+            if (down[w][r][c]) return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    int seeds   = arg(argc, argv, 1, 20000);
+    int keys    = arg(argc, argv, 2, MATRIX_COLS);
+    int max_gap = arg(argc, argv, 3, 120);
+    if (keys < 1 || keys > MATRIX_COLS) keys = MATRIX_COLS;
+
+    int identical = 0, differ = 0, overflow = 0;
+    int clears_new = 0, stuck_ref = 0, stuck_new = 0;
+    for (int seed = 1; seed <= seeds; seed++) {
+        rnd_state = seed;
+        memset(log_len, 0, sizeof(log_len));
+        memset(clears, 0, sizeof(clears));
+        memset(down, 0, sizeof(down));
+        bool state[MATRIX_ROWS][MATRIX_COLS] = {};
+        now = 1;
+
+        int n = 10 + rnd(60);
+        for (int i = 0; i < n + MATRIX_ROWS * keys; i++) {
+            uint8_t row, col;
+            if (i < n) {
+                row = rnd(MATRIX_ROWS);
+                col = rnd(keys);
+            } else {
+                // release all keys left down
+                row = (i - n) / keys;
+                col = (i - n) % keys;
+                if (!state[row][col]) continue;
+            }
+            wait_ms(rnd(max_gap + 1));
+            state[row][col] = !state[row][col];
+            now++;
+            feed((keyevent_t){ .key = { .row = row, .col = col },
+                               .pressed = state[row][col], .time = now | 1 });
+        }
+        wait_ms(2000);
+
+        if (clears[NEW]) clears_new++;
+        if (any_down(REF)) stuck_ref++;
+        if (any_down(NEW)) {
+            if (!any_down(REF) && stuck_new < 3) {
+                printf("seed %d keys left down:\n ref %s\n new %s\n", seed, logs[REF], logs[NEW]);
+            }
+            stuck_new++;
+        }
+        if (clears[REF]) {
+            overflow++;
+            continue;
+        }
+        if (log_len[REF] != log_len[NEW] || memcmp(logs[REF], logs[NEW], log_len[REF])) {
+            if (REF_WAITING_BUFFER_SIZE == WAITING_BUFFER_SIZE && differ < 3) {
+                printf("seed %d:\n ref %s\n new %s\n", seed, logs[REF], logs[NEW]);
+            }
+            differ++;
+        } else {
+            identical++;
+        }
+    }
+    printf("tapping_fuzz: TAPPING_TERM %u buffer %u ref %u, %d keys gap %dms: "
+           "identical %d differ %d ref overflowed %d | "
+           "new cleared %d | keys left down ref %d new %d\n",
+           TAPPING_TERM, WAITING_BUFFER_SIZE, REF_WAITING_BUFFER_SIZE, keys, max_gap,
+           identical, differ, overflow, clears_new, stuck_ref, stuck_new);
+    if (clears_new || stuck_new > stuck_ref) return 1;
+    if (REF_WAITING_BUFFER_SIZE == WAITING_BUFFER_SIZE) return differ ? 1 : 0;
+    return 0;
+}
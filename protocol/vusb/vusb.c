@@ -94,6 +94,12 @@ static void send_keyboard(report_keyboard_t *report)
     vusb_transfer_keyboard();
 }
 
+/* keyboard buffer is full; macro player waits for this */
+bool host_send_busy(void)
+{
+    return (kbuf_head + 1) % KBUF_SIZE == kbuf_tail;
+}
+
 
 typedef struct {
     uint8_t report_id;
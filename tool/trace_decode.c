@@ -0,0 +1,95 @@
+/*
+Copyright 2026 agent <agent@local>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Decoder of binary debug trace(DEBUG_TRACE_ENABLE)
+ *
+ * Reads console output(hid_listen) on stdin and renders trace lines with
+ * formats of common/trace_format.h; other lines are passed through.
+ *
+ *     $ cc -o trace_decode tool/trace_decode.c -Icommon
+ *     $ hid_listen | ./trace_decode
+ *
+ * Time is shown in milliseconds since boot and difference from last record.
+ * A gap in sequence number means lines were lost in console.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "trace.h"
+
+
+static const char *formats[TRACE_IDS] = {
+#undef TRACE_FORMAT
+#define TRACE_FORMAT(id, format)    [id] = format,
+#include "trace_format.h"
+};
+
+static int hex(const char *s, int digits, unsigned long *v)
+{
+    *v = 0;
+    while (digits--) {
+        char c = *s++;
+        int n;
+        if (c >= '0' && c <= '9')       n = c - '0';
+        else if (c >= 'A' && c <= 'F')  n = c - 'A' + 10;
+        else                            return 0;
+        *v = *v << 4 | n;
+    }
+    return 1;
+}
+
+/* ~IISSTTTTTTTTAAAABBBBBBBB */
+static int decode(const char *s, unsigned long *id, unsigned long *seq,
+                  unsigned long *time, unsigned long *a, unsigned long *b)
+{
+    return hex(s + 1, 2, id) && hex(s + 3, 2, seq) && hex(s + 5, 8, time) &&
+           hex(s + 13, 4, a) && hex(s + 17, 8, b) && *id < TRACE_IDS;
+}
+
+int main(void)
+{
+    char line[1024];
+    unsigned long last_time = 0, last_seq = 0;
+    int first = 1;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        /* trace line may follow text which was not terminated by newline */
+        char *s = strchr(line, '~');
+        unsigned long id, seq, time, a, b;
+        if (!s || strlen(s) < TRACE_LINE_SIZE - 1 || !decode(s, &id, &seq, &time, &a, &b)) {
+            fputs(line, stdout);
+            continue;
+        }
+        if (s != line) {
+            fwrite(line, 1, s - line, stdout);
+            putchar('\n');
+        }
+
+        if (!first && ((last_seq + 1) & 0xFF) != seq) {
+            printf("-- %lu lines lost\n", (seq - last_seq - 1) & 0xFF);
+        }
+        printf("%10.3f %+9.3f  ", time / 1000.0,
+               first ? 0.0 : (double)(uint32_t)(time - last_time) / 1000.0);
+        printf(formats[id], (unsigned)a, b);
+        putchar('\n');
+        first = 0;
+        last_time = time;
+        last_seq = seq;
+    }
+    return 0;
+}